@@ -1,25 +1,108 @@
 #pragma once
+#include <cstddef>
 #include <cstdlib>
 #include <new>
 #include <stdlib.h>
+#include <sys/mman.h>
 
 // 64-byte aligned simple vector.
 
 namespace intgemm {
 
-template <class T> class AlignedVector {
-  public:
-    explicit AlignedVector(std::size_t size)
-      : size_(size) {
-      if (posix_memalign(reinterpret_cast<void **>(&mem_), 64, size * sizeof(T))) {
-        throw std::bad_alloc();
+// Optional ways to back an AlignedVector, or'd together.  Large matrices such
+// as prepared B are walked many times by Multiply, so 2 MiB pages save most of
+// their TLB misses.
+enum AllocationFlags : unsigned {
+  // Align to 2 MiB and madvise(MADV_HUGEPAGE) for transparent huge pages.
+  kHugePages = 1,
+  // Explicit huge pages with MAP_HUGETLB, which need a reserved pool
+  // (vm.nr_hugepages).  Falls back to kHugePages when the pool is empty.
+  kHugeTLB = 2,
+  // Touch every page now instead of on first use.
+  kPrefault = 4,
+  // mlock so the pages are never swapped out.  Best effort: allocation does
+  // not fail if RLIMIT_MEMLOCK is too low.
+  kLock = 8
+};
+
+namespace detail {
+
+const std::size_t kHugePageSize = std::size_t(1) << 21;
+
+// Returns memory for bytes bytes with flags.  mapped is set to the length
+// passed to mmap or 0 if the memory came from posix_memalign.
+static inline void *AlignedAllocate(std::size_t bytes, unsigned flags, std::size_t &mapped) {
+  void *mem = nullptr;
+  mapped = 0;
+  if (flags & (kHugePages | kHugeTLB)) {
+    const std::size_t rounded = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+#ifdef MAP_HUGETLB
+    if ((flags & kHugeTLB) && rounded) {
+      mem = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (mem == MAP_FAILED) {
+        mem = nullptr;
+      } else {
+        mapped = rounded;
       }
     }
+#endif
+    if (!mem) {
+      if (posix_memalign(&mem, kHugePageSize, rounded)) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+      madvise(mem, rounded, MADV_HUGEPAGE);
+#endif
+    }
+  } else if (posix_memalign(&mem, 64, bytes)) {
+    throw std::bad_alloc();
+  }
+  if (flags & kPrefault) {
+    volatile char *touch = static_cast<char*>(mem);
+    for (std::size_t i = 0; i < bytes; i += 4096) touch[i] = 0;
+  }
+  if ((flags & kLock) && bytes) mlock(mem, bytes);
+  return mem;
+}
+
+static inline void AlignedFree(void *mem, std::size_t bytes, unsigned flags, std::size_t mapped) {
+  if ((flags & kLock) && bytes) munlock(mem, bytes);
+  if (mapped) {
+    munmap(mem, mapped);
+  } else {
+    std::free(mem);
+  }
+}
+
+} // namespace detail
+
+template <class T> class AlignedVector {
+  public:
+    // flags is a combination of AllocationFlags.
+    explicit AlignedVector(std::size_t size, unsigned flags = 0)
+      : flags_(flags), mapped_(0), mem_(static_cast<T*>(detail::AlignedAllocate(size * sizeof(T), flags, mapped_))), size_(size) {}
 
     AlignedVector(const AlignedVector&) = delete;
     AlignedVector& operator=(const AlignedVector&) = delete;
 
-    ~AlignedVector() { std::free(mem_); }
+    AlignedVector(AlignedVector &&from) : flags_(from.flags_), mapped_(from.mapped_), mem_(from.mem_), size_(from.size_) {
+      from.mem_ = nullptr;
+      from.size_ = 0;
+      from.mapped_ = 0;
+    }
+    AlignedVector &operator=(AlignedVector &&from) {
+      if (this != &from) {
+        detail::AlignedFree(mem_, size_ * sizeof(T), flags_, mapped_);
+        flags_ = from.flags_;
+        mapped_ = from.mapped_;
+        mem_ = from.mem_;
+        size_ = from.size_;
+        from.mem_ = nullptr;
+        from.size_ = 0;
+        from.mapped_ = 0;
+      }
+      return *this;
+    }
+
+    ~AlignedVector() { detail::AlignedFree(mem_, size_ * sizeof(T), flags_, mapped_); }
 
     std::size_t size() const { return size_; }
 
@@ -35,8 +118,42 @@ template <class T> class AlignedVector {
     ReturnType *as() { return reinterpret_cast<ReturnType*>(mem_); }
 
   private:
+    unsigned flags_;
+    // Set by the allocation, so declared before mem_.
+    std::size_t mapped_;
     T *mem_;
     std::size_t size_;
 };
 
+// Bump-pointer arena that packs the prepared matrices of a model into one
+// allocation, each 64-byte aligned, e.g. with kHugePages so the whole model
+// is covered by a few TLB entries:
+//
+//   intgemm::WeightArena arena(bytes, intgemm::kHugePages);
+//   int8_t *W = arena.Allocate<int8_t>(rows * cols);
+//   intgemm::Int8::PrepareB(W_float, W, quant_mult, rows, cols);
+//
+// Memory is only returned all at once, by Reset or destruction.
+class WeightArena {
+  public:
+    explicit WeightArena(std::size_t capacity, unsigned flags = 0)
+      : memory_(capacity, flags), used_(0) {}
+
+    // Throws std::bad_alloc if the arena is full.
+    template <class T> T *Allocate(std::size_t count) {
+      const std::size_t begin = (used_ + 63) & ~std::size_t(63);
+      if (begin > memory_.size() || count * sizeof(T) > memory_.size() - begin) throw std::bad_alloc();
+      used_ = begin + count * sizeof(T);
+      return reinterpret_cast<T*>(memory_.begin() + begin);
+    }
+
+    std::size_t Used() const { return used_; }
+    std::size_t Capacity() const { return memory_.size(); }
+    void Reset() { used_ = 0; }
+
+  private:
+    AlignedVector<char> memory_;
+    std::size_t used_;
+};
+
 } // namespace intgemm
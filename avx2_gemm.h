@@ -68,13 +68,24 @@ struct AVX2_16bit {
   INTGEMM_AVX2 static void Quantize(const float *input, int16_t *output, float quant_mult, Index size) {
     assert(size % 16 == 0);
     assert(reinterpret_cast<uintptr_t>(input) % 32 == 0);
+#pragma omp parallel
+    {
+      QuantizeThread(input, output, quant_mult, size);
+    }
+  }
+
+ private:
+  // Split from Quantize for OpenMP like AVX2_8bit::QuantizeThread.
+  INTGEMM_AVX2 static void QuantizeThread(const float *input, int16_t *output, float quant_mult, std::size_t count) {
     avx2::QuantizeTile16 q(quant_mult);
-    const float *end = input + size;
-    for (; input != end; input += 16, output += 16) {
-      *reinterpret_cast<__m256i*>(output) = q.Consecutive(input);
+#pragma omp for
+    for (std::size_t i = 0; i < count; i += 16) {
+      *reinterpret_cast<__m256i*>(output + i) = q.Consecutive(input + i);
     }
   }
 
+ public:
+
   // Tile size for B; B must be a multiple of this block size.
   static const Index kBTileRow = 16;
   static const Index kBTileCol = 8;
@@ -194,6 +205,20 @@ INTGEMM_MAXABSOLUTE(__m256, INTGEMM_AVX2)
 
 INTGEMM_VECTORMEANSTD(__m256, INTGEMM_AVX2)
 
+INTGEMM_ABSOLUTEHISTOGRAM(__m256, INTGEMM_AVX2)
+
+INTGEMM_QUANTIZEZEROPOINT(__m256, INTGEMM_AVX2)
+
+INTGEMM_ROWSTATISTICS(__m256, INTGEMM_AVX2)
+
+INTGEMM_QUANTIZECOLUMNSCALED(__m256, INTGEMM_AVX2)
+
+INTGEMM_QUANTIZEROWSCALED(__m256, INTGEMM_AVX2)
+
+INTGEMM_HADAMARD(__m256, INTGEMM_AVX2)
+
+INTGEMM_NORMALIZEROW(__m256, INTGEMM_AVX2)
+
 } // namespace
 
 struct AVX2_8bit {
@@ -238,6 +263,8 @@ struct AVX2_8bit {
 
   INTGEMM_MULTIPLY8(__m256i, INTGEMM_AVX2, CPUType::AVX2)
 
+  INTGEMM_MULTIPLY8GROUPED(__m256i, INTGEMM_AVX2, CPUType::AVX2)
+
   INTGEMM_MULTIPLY8SHIFT(__m256i, INTGEMM_AVX2, CPUType::AVX2)
 
   INTGEMM_PREPAREBIASFOR8(__m256i, INTGEMM_AVX2, CPUType::AVX2)
@@ -161,6 +161,20 @@ INTGEMM_MAXABSOLUTE(__m512, INTGEMM_AVX512BW)
 
 INTGEMM_VECTORMEANSTD(__m512, INTGEMM_AVX512BW)
 
+INTGEMM_ABSOLUTEHISTOGRAM(__m512, INTGEMM_AVX512BW)
+
+INTGEMM_QUANTIZEZEROPOINT(__m512, INTGEMM_AVX512BW)
+
+INTGEMM_ROWSTATISTICS(__m512, INTGEMM_AVX512BW)
+
+INTGEMM_QUANTIZECOLUMNSCALED(__m512, INTGEMM_AVX512BW)
+
+INTGEMM_QUANTIZEROWSCALED(__m512, INTGEMM_AVX512BW)
+
+INTGEMM_HADAMARD(__m512, INTGEMM_AVX512BW)
+
+INTGEMM_NORMALIZEROW(__m512, INTGEMM_AVX512BW)
+
 } // namespace
 
 struct AVX512_16bit {
@@ -181,16 +195,26 @@ struct AVX512_16bit {
   INTGEMM_AVX512BW static void Quantize(const float *input, int16_t *output, float quant_mult, Index size) {
     assert(size % 16 == 0);
     assert(reinterpret_cast<uintptr_t>(input) % 64 == 0);
+#pragma omp parallel
+    {
+      QuantizeThread(input, output, quant_mult, size);
+    }
+  }
+
+ private:
+  // Split from Quantize for OpenMP; see AVX512_8bit::QuantizeThread.
+  /* Only INTGEMM_AVX512F is necessary but due to GCC 5.4 bug we have to set INTGEMM_AVX512BW */
+  INTGEMM_AVX512BW static void QuantizeThread(const float *input, int16_t *output, float quant_mult, std::size_t count) {
     // Fill with the quantization multiplier.
     const __m512 quant_mult_reg = _mm512_set1_ps(quant_mult);
-    const float *end = input + size;
-    for (; input != end; input += 16, output += 16) {
+#pragma omp for
+    for (std::size_t i = 0; i < count; i += 16) {
       // There doesn't seem to be an unmasked version.
-      _mm512_mask_cvtsepi32_storeu_epi16(output, 0xffff, avx512f::QuantizerGrab(input, quant_mult_reg));
+      _mm512_mask_cvtsepi32_storeu_epi16(output + i, 0xffff, avx512f::QuantizerGrab(input + i, quant_mult_reg));
     }
   }
 
-
+ public:
   // Tile size for B; B must be a multiple of this block size.
   static const Index kBTileRow = 32;
   static const Index kBTileCol = 8;
@@ -328,11 +352,14 @@ struct AVX512_8bit {
     assert(B_cols % 8 == 0);
     assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0);
     assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
+    // Two panels at a time so the callback runs on full 512-bit registers.
+    if (B_cols % 16 == 0) {
+      Multiply16Columns(A, B, A_rows, width, B_cols, callback);
+      return;
+    }
     // There's 8 results for INTGEMM_AVX2 to handle.
     auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
     const int simd_width = width / sizeof(Register);
-    // Added for AVX512.
-    Register zeros = setzero_si<Register>();
     // Go over 8 columns of B at a time.
 #pragma omp for
     for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
@@ -341,97 +368,160 @@ struct AVX512_8bit {
       for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) {
         // Iterate over shared (inner) dimension.
         const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width);
-        const Register *A_end = A_live + simd_width;
-        const Register *B_live = B0_col;
-
-        // Do the first iteration to initialize the sums.
-        __m512i a = *A_live;
-        __mmask64 neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
-        __m512i a_positive = _mm512_abs_epi8(a);
-        // These will be packed 16-bit integers containing sums for each column of B multiplied by the row of A.
-        Register sum0 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[0], neg_mask, zeros, B_live[0]));
-        Register sum1 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[1], neg_mask, zeros, B_live[1]));
-        Register sum2 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[2], neg_mask, zeros, B_live[2]));
-        Register sum3 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[3], neg_mask, zeros, B_live[3]));
-        Register sum4 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[4], neg_mask, zeros, B_live[4]));
-        Register sum5 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[5], neg_mask, zeros, B_live[5]));
-        Register sum6 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[6], neg_mask, zeros, B_live[6]));
-        Register sum7 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[7], neg_mask, zeros, B_live[7]));
-
-        ++A_live;
-        B_live += 8;
-
-        // Use A as the loop variable so the add can be done where gcc likes it
-        // for branch prediction.
-        for (; A_live != A_end; ++A_live, B_live += 8) {
-          // Unique code here: can we do an inline function?
-          // Retrieve a.  We will use this as the unsigned part.
-          a = *A_live;
-          // Retrieve the conveniently consecutive values of B.
-          __m512i b0 = *B_live;
-          __m512i b1 = *(B_live + 1);
-          __m512i b2 = *(B_live + 2);
-          __m512i b3 = *(B_live + 3);
-          __m512i b4 = *(B_live + 4);
-          __m512i b5 = *(B_live + 5);
-          __m512i b6 = *(B_live + 6);
-          __m512i b7 = *(B_live + 7);
-
-          // Get a mask where a is negative.
-          // Didn't seem to make a difference definining sign bits here vs at top
-          neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
-          a_positive = _mm512_abs_epi8(a);
-
-          // Negate by subtracting from zero with a mask.
-          b0 = _mm512_mask_sub_epi8(b0, neg_mask, zeros, b0);
-          b1 = _mm512_mask_sub_epi8(b1, neg_mask, zeros, b1);
-          b2 = _mm512_mask_sub_epi8(b2, neg_mask, zeros, b2);
-          b3 = _mm512_mask_sub_epi8(b3, neg_mask, zeros, b3);
-          b4 = _mm512_mask_sub_epi8(b4, neg_mask, zeros, b4);
-          b5 = _mm512_mask_sub_epi8(b5, neg_mask, zeros, b5);
-          b6 = _mm512_mask_sub_epi8(b6, neg_mask, zeros, b6);
-          b7 = _mm512_mask_sub_epi8(b7, neg_mask, zeros, b7);
-          // The magic 8-bit multiply then horizontal sum into 16-bit.
-          b0 = _mm512_maddubs_epi16(a_positive, b0);
-          b1 = _mm512_maddubs_epi16(a_positive, b1);
-          b2 = _mm512_maddubs_epi16(a_positive, b2);
-          b3 = _mm512_maddubs_epi16(a_positive, b3);
-          b4 = _mm512_maddubs_epi16(a_positive, b4);
-          b5 = _mm512_maddubs_epi16(a_positive, b5);
-          b6 = _mm512_maddubs_epi16(a_positive, b6);
-          b7 = _mm512_maddubs_epi16(a_positive, b7);
-          // Now we have 16-bit results that are the sum of two multiplies.
-          // Choosing to approximate and do adds.
-          // Perhaps every so often we could accumulate by upcasting.
-          sum0 = _mm512_adds_epi16(sum0, b0);
-          sum1 = _mm512_adds_epi16(sum1, b1);
-          sum2 = _mm512_adds_epi16(sum2, b2);
-          sum3 = _mm512_adds_epi16(sum3, b3);
-          sum4 = _mm512_adds_epi16(sum4, b4);
-          sum5 = _mm512_adds_epi16(sum5, b5);
-          sum6 = _mm512_adds_epi16(sum6, b6);
-          sum7 = _mm512_adds_epi16(sum7, b7);
-          // Unique code ends: can we do an inline function?
+        Register pack0123, pack4567;
+        Sum8Columns(A_live, A_live + simd_width, B0_col, pack0123, pack4567);
+        auto total = PermuteSummer(pack0123, pack4567);
+        callback_impl(total, callbacks::OutputBufferInfo(A_rowidx, B0_colidx, A_rows, B_cols));
+      }
+    }
+  }
+
+  // See INTGEMM_MULTIPLY8GROUPED.  Sum8Columns runs once per group.
+  template <typename Callback>
+  INTGEMM_AVX512BW static void MultiplyGrouped(const int8_t *A, const int8_t *B, const float *A_scales, const float *B_scales, Index group_size, Index A_rows, Index width, Index B_cols, Callback callback) {
+    typedef __m512i Register;
+    assert(group_size % sizeof(Register) == 0);
+    assert(width % group_size == 0);
+    assert(B_cols % 8 == 0);
+    assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0);
+    assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
+    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
+    const int simd_width = width / sizeof(Register);
+    const int simd_group = group_size / sizeof(Register);
+    const Index groups = width / group_size;
+#pragma omp for
+    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
+      const Register *B0_col = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width;
+      for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) {
+        const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width);
+        __m256 accumulate = _mm256_setzero_ps();
+        for (Index group = 0; group < groups; ++group) {
+          Register pack0123, pack4567;
+          Sum8Columns(A_live + group * simd_group, A_live + (group + 1) * simd_group, B0_col + group * simd_group * 8, pack0123, pack4567);
+          __m256 a_scale = _mm256_set1_ps(A_scales ? A_scales[A_rowidx * groups + group] : 1.0f);
+          ScaleAndAccumulate(PermuteSummer(pack0123, pack4567), B_scales + group * B_cols + B0_colidx, a_scale, accumulate);
         }
-        // Upcast to 32-bit and horizontally add.
-        Register ones = set1_epi16<Register>(1);
-        sum0 = madd_epi16(sum0, ones);
-        sum1 = madd_epi16(sum1, ones);
-        sum2 = madd_epi16(sum2, ones);
-        sum3 = madd_epi16(sum3, ones);
-        sum4 = madd_epi16(sum4, ones);
-        sum5 = madd_epi16(sum5, ones);
-        sum6 = madd_epi16(sum6, ones);
-        sum7 = madd_epi16(sum7, ones);
-        Register pack0123 = Pack0123(sum0, sum1, sum2, sum3);
-        Register pack4567 = Pack0123(sum4, sum5, sum6, sum7);
+        callback_impl(accumulate, callbacks::OutputBufferInfo(A_rowidx, B0_colidx, A_rows, B_cols));
+      }
+    }
+  }
 
-        auto total = PermuteSummer(pack0123, pack4567);
+ private:
+  // Dot products of a row of A with one 8-column panel of B, left as two
+  // Pack0123 registers for PermuteSummer.
+  INTGEMM_AVX512BW static inline void Sum8Columns(const __m512i *A_live, const __m512i *A_end, const __m512i *B_live, __m512i &pack0123, __m512i &pack4567) {
+    typedef __m512i Register;
+    // Added for AVX512.
+    Register zeros = setzero_si<Register>();
+    // Do the first iteration to initialize the sums.
+    __m512i a = *A_live;
+    __mmask64 neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
+    __m512i a_positive = _mm512_abs_epi8(a);
+    // These will be packed 16-bit integers containing sums for each column of B multiplied by the row of A.
+    Register sum0 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[0], neg_mask, zeros, B_live[0]));
+    Register sum1 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[1], neg_mask, zeros, B_live[1]));
+    Register sum2 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[2], neg_mask, zeros, B_live[2]));
+    Register sum3 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[3], neg_mask, zeros, B_live[3]));
+    Register sum4 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[4], neg_mask, zeros, B_live[4]));
+    Register sum5 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[5], neg_mask, zeros, B_live[5]));
+    Register sum6 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[6], neg_mask, zeros, B_live[6]));
+    Register sum7 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[7], neg_mask, zeros, B_live[7]));
+
+    ++A_live;
+    B_live += 8;
+
+    // Use A as the loop variable so the add can be done where gcc likes it
+    // for branch prediction.
+    for (; A_live != A_end; ++A_live, B_live += 8) {
+      // Unique code here: can we do an inline function?
+      // Retrieve a.  We will use this as the unsigned part.
+      a = *A_live;
+      // Retrieve the conveniently consecutive values of B.
+      __m512i b0 = *B_live;
+      __m512i b1 = *(B_live + 1);
+      __m512i b2 = *(B_live + 2);
+      __m512i b3 = *(B_live + 3);
+      __m512i b4 = *(B_live + 4);
+      __m512i b5 = *(B_live + 5);
+      __m512i b6 = *(B_live + 6);
+      __m512i b7 = *(B_live + 7);
+
+      // Get a mask where a is negative.
+      // Didn't seem to make a difference definining sign bits here vs at top
+      neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
+      a_positive = _mm512_abs_epi8(a);
+
+      // Negate by subtracting from zero with a mask.
+      b0 = _mm512_mask_sub_epi8(b0, neg_mask, zeros, b0);
+      b1 = _mm512_mask_sub_epi8(b1, neg_mask, zeros, b1);
+      b2 = _mm512_mask_sub_epi8(b2, neg_mask, zeros, b2);
+      b3 = _mm512_mask_sub_epi8(b3, neg_mask, zeros, b3);
+      b4 = _mm512_mask_sub_epi8(b4, neg_mask, zeros, b4);
+      b5 = _mm512_mask_sub_epi8(b5, neg_mask, zeros, b5);
+      b6 = _mm512_mask_sub_epi8(b6, neg_mask, zeros, b6);
+      b7 = _mm512_mask_sub_epi8(b7, neg_mask, zeros, b7);
+      // The magic 8-bit multiply then horizontal sum into 16-bit.
+      b0 = _mm512_maddubs_epi16(a_positive, b0);
+      b1 = _mm512_maddubs_epi16(a_positive, b1);
+      b2 = _mm512_maddubs_epi16(a_positive, b2);
+      b3 = _mm512_maddubs_epi16(a_positive, b3);
+      b4 = _mm512_maddubs_epi16(a_positive, b4);
+      b5 = _mm512_maddubs_epi16(a_positive, b5);
+      b6 = _mm512_maddubs_epi16(a_positive, b6);
+      b7 = _mm512_maddubs_epi16(a_positive, b7);
+      // Now we have 16-bit results that are the sum of two multiplies.
+      // Choosing to approximate and do adds.
+      // Perhaps every so often we could accumulate by upcasting.
+      sum0 = _mm512_adds_epi16(sum0, b0);
+      sum1 = _mm512_adds_epi16(sum1, b1);
+      sum2 = _mm512_adds_epi16(sum2, b2);
+      sum3 = _mm512_adds_epi16(sum3, b3);
+      sum4 = _mm512_adds_epi16(sum4, b4);
+      sum5 = _mm512_adds_epi16(sum5, b5);
+      sum6 = _mm512_adds_epi16(sum6, b6);
+      sum7 = _mm512_adds_epi16(sum7, b7);
+      // Unique code ends: can we do an inline function?
+    }
+    // Upcast to 32-bit and horizontally add.
+    Register ones = set1_epi16<Register>(1);
+    sum0 = madd_epi16(sum0, ones);
+    sum1 = madd_epi16(sum1, ones);
+    sum2 = madd_epi16(sum2, ones);
+    sum3 = madd_epi16(sum3, ones);
+    sum4 = madd_epi16(sum4, ones);
+    sum5 = madd_epi16(sum5, ones);
+    sum6 = madd_epi16(sum6, ones);
+    sum7 = madd_epi16(sum7, ones);
+    pack0123 = Pack0123(sum0, sum1, sum2, sum3);
+    pack4567 = Pack0123(sum4, sum5, sum6, sum7);
+  }
+
+  // Multiply for B_cols % 16 == 0: takes two adjacent 8-column panels of B per
+  // row of A and hands all 16 results to the AVX512BW callback in one register.
+  // Sums are bit-identical to the 8-column path.
+  template <typename Callback>
+  INTGEMM_AVX512BW static void Multiply16Columns(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    typedef __m512i Register;
+    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX512BW, Callback>(callback);
+    const int simd_width = width / sizeof(Register);
+#pragma omp for
+    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 16) {
+      const Register *B0_col = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width;
+      // The next panel of 8 columns follows directly.
+      const Register *B1_col = B0_col + 8 * simd_width;
+      for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) {
+        const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width);
+        const Register *A_end = A_live + simd_width;
+        Register pack0123, pack4567, pack89ab, packcdef;
+        Sum8Columns(A_live, A_end, B0_col, pack0123, pack4567);
+        Sum8Columns(A_live, A_end, B1_col, pack89ab, packcdef);
+        auto total = PermuteSummer(pack0123, pack4567, pack89ab, packcdef);
         callback_impl(total, callbacks::OutputBufferInfo(A_rowidx, B0_colidx, A_rows, B_cols));
       }
     }
   }
 
+ public:
   INTGEMM_MULTIPLY8SHIFT(__m512i, INTGEMM_AVX512BW, CPUType::AVX2)
 
   INTGEMM_PREPAREBIASFOR8(__m512i, INTGEMM_AVX512BW, CPUType::AVX2)
@@ -0,0 +1,148 @@
+#include "calibration.h"
+#include "intgemm.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace intgemm {
+
+namespace {
+// Floats handed to AbsoluteHistogram at a time; a multiple of 16 keeps every chunk 64-byte aligned.
+const std::size_t kHistogramChunk = 16384;
+
+// Largest finite absolute value in [begin, end), or 0 if there is none.
+float MaxFiniteAbsolute(const float *begin, const float *end) {
+  float max = 0.0f;
+  for (const float *i = begin; i != end; ++i) {
+    if (std::isfinite(*i)) max = std::max(max, std::fabs(*i));
+  }
+  return max;
+}
+} // namespace
+
+Histogram::Histogram(Index bins) : counts_(bins), range_(0.0f), total_(0) {
+  assert(bins >= 2 && bins % 2 == 0);
+}
+
+void Histogram::Add(const float *begin, const float *end) {
+  if (begin == end) return;
+  const std::size_t size = end - begin;
+  total_ += size;
+  float max = MaxAbsolute(begin, end);
+  // Infinity and NaN do not widen the range; AbsoluteHistogram counts them in the last bin.
+  if (!std::isfinite(max)) max = MaxFiniteAbsolute(begin, end);
+  if (max == 0.0f && range_ == 0.0f) {
+    const std::size_t finite = std::count_if(begin, end, [](float value) { return std::isfinite(value); });
+    counts_[0] += finite;
+    counts_[Bins() - 1] += size - finite;
+    return;
+  }
+  // Earlier values, if any, were all zero or not finite, and stay in the first or last bin.
+  if (range_ == 0.0f) range_ = max;
+  // Double the range until it covers this batch.
+  const Index bins = Bins();
+  while (range_ < max && range_ * 2.0f <= std::numeric_limits<float>::max()) {
+    for (Index i = 0; i < bins / 2; ++i)
+      counts_[i] = counts_[2 * i] + counts_[2 * i + 1];
+    std::fill(counts_.begin() + bins / 2, counts_.end(), 0);
+    range_ *= 2.0f;
+  }
+
+  const float bins_per_unit = bins / range_;
+  const std::size_t chunks = (size + kHistogramChunk - 1) / kHistogramChunk;
+#pragma omp parallel
+  {
+    std::vector<uint64_t> local(bins);
+#pragma omp for schedule(static)
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+      const float *chunk_begin = begin + chunk * kHistogramChunk;
+      const float *chunk_end = std::min(chunk_begin + kHistogramChunk, end);
+      AbsoluteHistogram(chunk_begin, chunk_end, bins_per_unit, bins, local.data());
+    }
+#pragma omp critical
+    for (Index i = 0; i < bins; ++i)
+      counts_[i] += local[i];
+  }
+}
+
+float Histogram::Percentile(double percentile) const {
+  const uint64_t target = static_cast<uint64_t>(std::ceil(total_ * percentile / 100.0));
+  const float width = range_ / Bins();
+  uint64_t below = 0;
+  for (Index i = 0; i < Bins(); ++i) {
+    below += counts_[i];
+    if (below >= target) return (i + 1) * width;
+  }
+  return range_;
+}
+
+float Histogram::Entropy(Index levels) const {
+  const Index bins = Bins();
+  assert(levels > 0 && levels <= bins);
+  if (range_ == 0.0f) return 0.0f;
+
+  double best_divergence = std::numeric_limits<double>::infinity();
+  Index best = bins;
+  std::vector<double> candidate(bins);
+  // Counts at or above bin i, which are clipped when the threshold is bin i.
+  uint64_t outliers = 0;
+  for (Index i = levels; i < bins; ++i) outliers += counts_[i];
+
+  for (Index i = levels; i <= bins; ++i) {
+    // Reference: bins [0, i) with the outliers folded into the last one.
+    // Candidate: merge bins [0, i) into levels groups and spread each group's
+    // total evenly over the bins where the reference is nonzero.
+    uint64_t clipped_total = 0;
+    Index zeros = 0;
+    for (Index level = 0; level < levels; ++level) {
+      const Index start = static_cast<Index>(static_cast<uint64_t>(level) * i / levels);
+      const Index stop = static_cast<Index>(static_cast<uint64_t>(level + 1) * i / levels);
+      uint64_t sum = 0;
+      Index nonzero = 0;
+      for (Index j = start; j < stop; ++j) {
+        sum += counts_[j];
+        nonzero += (counts_[j] != 0 || (j == i - 1 && outliers));
+      }
+      for (Index j = start; j < stop; ++j) {
+        bool reference_nonzero = counts_[j] != 0 || (j == i - 1 && outliers);
+        candidate[j] = reference_nonzero ? static_cast<double>(sum) / nonzero : 0.0;
+        zeros += (candidate[j] == 0.0);
+      }
+      clipped_total += sum;
+    }
+    if (!clipped_total) continue;
+    // Smooth the candidate like MXNet: empty bins, such as the last bin when
+    // only outliers land there, get kSmoothing counts so the divergence stays
+    // finite.
+    const double kSmoothing = 0.0001;
+    const double candidate_total = clipped_total + kSmoothing * zeros;
+    // Both distributions are normalized inside the sum.
+    double divergence = 0.0;
+    for (Index j = 0; j < i; ++j) {
+      double reference = static_cast<double>(counts_[j] + (j == i - 1 ? outliers : 0)) / total_;
+      if (reference == 0.0) continue;
+      double quantized = (candidate[j] == 0.0 ? kSmoothing : candidate[j]) / candidate_total;
+      divergence += reference * std::log(reference / quantized);
+    }
+    if (divergence < best_divergence) {
+      best_divergence = divergence;
+      best = i;
+    }
+    if (i < bins) outliers -= counts_[i];
+  }
+  return best * (range_ / bins);
+}
+
+void SmoothingScales(const float *activation_max, const float *weight_max, Index size, float alpha, float *smooth, float *inverse_smooth) {
+  for (Index k = 0; k < size; ++k) {
+    float scale = 1.0f;
+    if (activation_max[k] > 0.0f && weight_max[k] > 0.0f)
+      scale = std::pow(activation_max[k], alpha) / std::pow(weight_max[k], 1.0f - alpha);
+    smooth[k] = scale;
+    inverse_smooth[k] = 1.0f / scale;
+  }
+}
+
+} // namespace intgemm
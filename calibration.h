@@ -0,0 +1,66 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstdint>
+#include <vector>
+
+/* Calibration: choosing quant_mult from statistics gathered over many batches
+ * instead of MaxAbsolute of a single one.  Feed every calibration batch of a
+ * tensor to Histogram::Add, then pick a clipping threshold with Percentile or
+ * Entropy and quantize with QuantMult(threshold):
+ *
+ *   intgemm::Histogram histogram;
+ *   for (...) histogram.Add(batch.begin(), batch.end());
+ *   float quant_mult = intgemm::QuantMult(histogram.Entropy());
+ *   intgemm::Int8::PrepareA(A, A_prepared, quant_mult, rows, cols);
+ *
+ * Values beyond the threshold saturate in Quantize.
+ */
+
+namespace intgemm {
+
+// Histogram of absolute values with a fixed number of bins over [0, Range()).
+// The range doubles (merging pairs of bins) whenever a batch exceeds it.
+class Histogram {
+  public:
+    // bins must be even.
+    explicit Histogram(Index bins = 2048);
+
+    // Count the absolute values of [begin, end).  begin must be 64-byte
+    // aligned.  Uses all OpenMP threads when compiled with OpenMP.  Infinity
+    // and NaN are counted in the last bin and do not widen the range.
+    void Add(const float *begin, const float *end);
+
+    Index Bins() const { return static_cast<Index>(counts_.size()); }
+    float Range() const { return range_; }
+    uint64_t Total() const { return total_; }
+    const std::vector<uint64_t> &Counts() const { return counts_; }
+
+    // Smallest bin edge below which at least percentile (0 to 100) percent of the values lie.
+    float Percentile(double percentile) const;
+
+    // Threshold minimizing the KL divergence between the distribution clipped
+    // at the threshold and the same distribution quantized to levels levels
+    // (128 for int8).  This is the entropy calibration of TensorRT.
+    float Entropy(Index levels = 128) const;
+
+  private:
+    std::vector<uint64_t> counts_;
+    float range_;
+    uint64_t total_;
+};
+
+// quant_mult mapping threshold to max_quantized, or 1 for a zero threshold (all values were zero).
+static inline float QuantMult(float threshold, float max_quantized = 127.0f) {
+  return threshold > 0.0f ? max_quantized / threshold : 1.0f;
+}
+
+// SmoothQuant scales for Int8::PrepareASmooth and Int8::PrepareBSmooth:
+// smooth[k] = activation_max[k]^alpha / weight_max[k]^(1 - alpha), where
+// activation_max is the ColumnMaxAbsolute of A over calibration batches and
+// weight_max the RowMaxAbsolute of B.  inverse_smooth receives 1 / smooth.
+// Channels with a zero maximum on either side get 1.
+void SmoothingScales(const float *activation_max, const float *weight_max, Index size, float alpha, float *smooth, float *inverse_smooth);
+
+} // namespace intgemm
@@ -4,6 +4,7 @@
 #include "callbacks/output_buffer_info.h"
 
 #include "intgemm_config.h"
+#include "interleave.h"
 #include "intrinsics.h"
 #include "kernels.h"
 #include "types.h"
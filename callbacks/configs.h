@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../utils.h"
+
 #include <tuple>
 
 namespace intgemm {
@@ -54,5 +56,128 @@ struct UnquantizeAndAddBiasAndWrite {
   UnquantizeAndAddBiasAndWrite(float unquant_mult, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
 };
 
+/*
+ * For Int8Shift with a zero point per row of A (Int8Shift::PrepareAZeroPoint):
+ * output = unquant_mult * (input - zero_points[row] * column_sums[col]) + bias[col]
+ * where column_sums come from Int8Shift::PrepareColumnSums.
+ */
+struct UnquantizeAndSubtractZeroPointAndAddBiasAndWrite {
+  float unquant_mult;
+  const float* column_sums;
+  const uint8_t* zero_points;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeAndSubtractZeroPointAndAddBiasAndWrite(float unquant_mult, const float* column_sums, const uint8_t* zero_points, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), column_sums(column_sums), zero_points(zero_points), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+/*
+ * For Int8 with outlier decomposition (Int8::PrepareAOutliers):
+ * output = unquant_mult * input + sum_j outlier_values[row][j] * outlier_B[j][col] + bias[col]
+ * where outlier_B holds the count float rows of B gathered by Int8::PrepareBOutliers.
+ */
+struct UnquantizeAndAddOutliersAndBiasAndWrite {
+  float unquant_mult;
+  const float* outlier_values;
+  Index count;
+  const float* outlier_B;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeAndAddOutliersAndBiasAndWrite(float unquant_mult, const float* outlier_values, Index count, const float* outlier_B, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), outlier_values(outlier_values), count(count), outlier_B(outlier_B), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+/*
+ * For A quantized with a multiplier per row (e.g. Int8::PrepareANormRows):
+ * output = unquant_mult * row_unquant_mults[row] * input + bias[col]
+ * where unquant_mult is 1 / quant_mult of B.
+ */
+struct UnquantizeRowsAndAddBiasAndWrite {
+  float unquant_mult;
+  const float* row_unquant_mults;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeRowsAndAddBiasAndWrite(float unquant_mult, const float* row_unquant_mults, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), row_unquant_mults(row_unquant_mults), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+/*
+ * Accumulating configs add the result to what is already in the output
+ * (C = alpha * A * B + beta * C, with alpha folded into unquant_mult).
+ */
+template <typename Type>
+struct Accumulate {
+  Type* output_addr;
+
+  Accumulate(Type* output_addr) : output_addr(output_addr) {}
+};
+
+struct UnquantizeAndAccumulate {
+  float unquant_mult;
+  float* output_addr;
+  float beta;
+
+  UnquantizeAndAccumulate(float unquant_mult, float* output_addr, float beta = 1.f) : unquant_mult(unquant_mult), output_addr(output_addr), beta(beta) {}
+};
+
+struct AddBiasAndAccumulate {
+  const int* bias_addr;
+  int* output_addr;
+
+  AddBiasAndAccumulate(const int* bias_addr, int* output_addr) : bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+struct UnquantizeAndAddBiasAndAccumulate {
+  float unquant_mult;
+  const float* bias_addr;
+  float* output_addr;
+  float beta;
+
+  UnquantizeAndAddBiasAndAccumulate(float unquant_mult, const float* bias_addr, float* output_addr, float beta = 1.f) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr), beta(beta) {}
+};
+
+/*
+ * Transposed configs write C column-major, i.e. as the B_cols x A_rows matrix
+ * C^T.  Only 32-bit outputs are supported.
+ */
+template <typename Type>
+struct WriteTransposed {
+  Type* output_addr;
+
+  WriteTransposed(Type* output_addr) : output_addr(output_addr) {}
+};
+
+struct UnquantizeAndWriteTransposed {
+  float unquant_mult;
+  float* output_addr;
+
+  UnquantizeAndWriteTransposed(float unquant_mult, float* output_addr) : unquant_mult(unquant_mult), output_addr(output_addr) {}
+};
+
+/*
+ * Integer-only requantization configs: results are scaled by a fixed-point
+ * multiplier (see ToFixedPoint) and, when written, saturated to int8.
+ */
+struct Requantize {
+  FixedPointScale scale;
+
+  Requantize(FixedPointScale scale) : scale(scale) {}
+};
+
+struct RequantizeAndWrite {
+  FixedPointScale scale;
+  int8_t* output_addr;
+
+  RequantizeAndWrite(FixedPointScale scale, int8_t* output_addr) : scale(scale), output_addr(output_addr) {}
+};
+
+struct AddBiasAndRequantizeAndWrite {
+  const int* bias_addr;
+  FixedPointScale scale;
+  int8_t* output_addr;
+
+  AddBiasAndRequantizeAndWrite(const int* bias_addr, FixedPointScale scale, int8_t* output_addr) : bias_addr(bias_addr), scale(scale), output_addr(output_addr) {}
+};
+
 }
 }
@@ -12,15 +12,9 @@
   #error "Only SSE2, AVX2 and AVX512BW are supported"
 #endif
 
-#if defined(CALLBACKS_THIS_IS_SSE2)
-  #define vi vector_t<CPUType::SSE2, int>
-  #define vf vector_t<CPUType::SSE2, float>
-  #define vd vector_t<CPUType::SSE2, double>
-#else
-  #define vi vector_t<CPUType::AVX2, int>
-  #define vf vector_t<CPUType::AVX2, float>
-  #define vd vector_t<CPUType::AVX2, double>
-#endif
+#define vi vector_t<CPUType::CPU_NAME, int>
+#define vf vector_t<CPUType::CPU_NAME, float>
+#define vd vector_t<CPUType::CPU_NAME, double>
 
 namespace intgemm {
 namespace callbacks {
@@ -28,6 +22,9 @@ namespace callbacks {
 template <CPUType CpuType, typename CallbackConfig>
 class CallbackImpl;
 
+template <CPUType CpuType>
+class TransposedWriter;
+
 }}
 
 /*
@@ -173,9 +170,328 @@ private:
   vf unquant_mult;
 };
 
+/*
+ * UnquantizeAndSubtractZeroPointAndAddBiasAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndSubtractZeroPointAndAddBiasAndWrite> {
+public:
+  CPU_ATTR CallbackImpl(const UnquantizeAndSubtractZeroPointAndAddBiasAndWrite& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    auto correction = set1_ps<vf>(-config.unquant_mult * config.zero_points[info.row_idx]);
+    auto column_sums = *reinterpret_cast<const vf*>(config.column_sums + info.col_idx);
+    result = add_ps(result, mul_ps(correction, column_sums));
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+private:
+  UnquantizeAndSubtractZeroPointAndAddBiasAndWrite config;
+  vf unquant_mult;
+};
+
+/*
+ * UnquantizeAndAddOutliersAndBiasAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddOutliersAndBiasAndWrite> {
+public:
+  CPU_ATTR CallbackImpl(const UnquantizeAndAddOutliersAndBiasAndWrite& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    const float* values = config.outlier_values + info.row_idx * config.count;
+    for (Index j = 0; j < config.count; ++j) {
+      auto b = loadu_ps<vf>(config.outlier_B + j * info.cols + info.col_idx);
+      result = add_ps(result, mul_ps(set1_ps<vf>(values[j]), b));
+    }
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+private:
+  UnquantizeAndAddOutliersAndBiasAndWrite config;
+  vf unquant_mult;
+};
+
+/*
+ * UnquantizeRowsAndAddBiasAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeRowsAndAddBiasAndWrite> {
+public:
+  CPU_ATTR CallbackImpl(const UnquantizeRowsAndAddBiasAndWrite& config) : config(config) {}
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto unquant_mult = set1_ps<vf>(config.unquant_mult * config.row_unquant_mults[info.row_idx]);
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+private:
+  UnquantizeRowsAndAddBiasAndWrite config;
+};
+
+/*
+ * Accumulate
+ */
+template <typename Type>
+class CallbackImpl<CPUType::CPU_NAME, Accumulate<Type>> {
+public:
+  CPU_ATTR CallbackImpl(const Accumulate<Type>& config) : config(config) {}
+
+  CPU_ATTR void operator()(vector_t<CPUType::CPU_NAME, Type> input, const OutputBufferInfo& info) {
+    kernels::accumulate(input, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+
+private:
+  Accumulate<Type> config;
+};
+
+/*
+ * UnquantizeAndAccumulate
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAccumulate> {
+public:
+  CPU_ATTR CallbackImpl(const UnquantizeAndAccumulate& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+    beta = set1_ps<vf>(config.beta);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    kernels::accumulate(result, config.output_addr, beta, info.row_idx * info.cols + info.col_idx);
+  }
+
+private:
+  UnquantizeAndAccumulate config;
+  vf unquant_mult;
+  vf beta;
+};
+
+/*
+ * AddBiasAndAccumulate
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, AddBiasAndAccumulate> {
+public:
+  CPU_ATTR CallbackImpl(const AddBiasAndAccumulate& config) : config(config) {}
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::add_bias(input, config.bias_addr, info.col_idx);
+    kernels::accumulate(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+
+private:
+  AddBiasAndAccumulate config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndAccumulate
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndAccumulate> {
+public:
+  CPU_ATTR CallbackImpl(const UnquantizeAndAddBiasAndAccumulate& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+    beta = set1_ps<vf>(config.beta);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    kernels::accumulate(result, config.output_addr, beta, info.row_idx * info.cols + info.col_idx);
+  }
+
+private:
+  UnquantizeAndAddBiasAndAccumulate config;
+  vf unquant_mult;
+  vf beta;
+};
+
+/*
+ * Writes 32-bit results transposed.  Multiply visits the rows of a column
+ * block in order, so rows are buffered until a square tile is complete and
+ * the tile is then transposed in registers and stored one column at a time.
+ * Two tiles are kept because SSE2 delivers each 8-column block in two halves.
+ */
+template <> class TransposedWriter<CPUType::CPU_NAME> {
+public:
+  CPU_ATTR TransposedWriter() {
+    slots[0].count = slots[1].count = 0;
+  }
+
+  template <typename Type>
+  CPU_ATTR void operator()(vi input, Type* output, const OutputBufferInfo& info) {
+    static_assert(sizeof(Type) == sizeof(int), "Only 32-bit outputs can be written transposed");
+    Slot& slot = slots[(info.col_idx / kTile) % 2];
+    if (slot.count && (slot.col_idx != info.col_idx || slot.row_idx + slot.count != info.row_idx))
+      Flush(slot, output, info.rows);
+    if (!slot.count) {
+      slot.col_idx = info.col_idx;
+      slot.row_idx = info.row_idx;
+    }
+    slot.tile[slot.count++] = input;
+    if (slot.count == kTile || info.row_idx + 1 == info.rows)
+      Flush(slot, output, info.rows);
+  }
+
+private:
+  static constexpr Index kTile = sizeof(vi) / sizeof(int);
+
+  struct Slot {
+    vi tile[kTile];
+    Index col_idx;
+    Index row_idx;
+    Index count;
+  };
+
+  template <typename Type>
+  CPU_ATTR static void Flush(Slot& slot, Type* output, Index rows) {
+    Type* begin = output + slot.col_idx * rows + slot.row_idx;
+    if (slot.count == kTile) {
+      Transpose32(slot.tile);
+      for (Index i = 0; i < kTile; ++i)
+        storeu_si(reinterpret_cast<vi*>(begin + i * rows), slot.tile[i]);
+    } else {
+      // Partial tile at the bottom of the matrix.
+      for (Index r = 0; r < slot.count; ++r) {
+        const Type* row = reinterpret_cast<const Type*>(&slot.tile[r]);
+        for (Index i = 0; i < kTile; ++i)
+          begin[i * rows + r] = row[i];
+      }
+    }
+    slot.count = 0;
+  }
+
+  Slot slots[2];
+};
+
+/*
+ * WriteTransposed
+ */
+template <typename Type>
+class CallbackImpl<CPUType::CPU_NAME, WriteTransposed<Type>> {
+public:
+  CPU_ATTR CallbackImpl(const WriteTransposed<Type>& config) : config(config) {}
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    writer(input, config.output_addr, info);
+  }
+
+  CPU_ATTR void operator()(vf input, const OutputBufferInfo& info) {
+    writer(*reinterpret_cast<vi*>(&input), config.output_addr, info);
+  }
+
+private:
+  WriteTransposed<Type> config;
+  TransposedWriter<CPUType::CPU_NAME> writer;
+};
+
+/*
+ * UnquantizeAndWriteTransposed
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndWriteTransposed> {
+public:
+  CPU_ATTR CallbackImpl(const UnquantizeAndWriteTransposed& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    writer(*reinterpret_cast<vi*>(&result), config.output_addr, info);
+  }
+
+private:
+  UnquantizeAndWriteTransposed config;
+  vf unquant_mult;
+  TransposedWriter<CPUType::CPU_NAME> writer;
+};
+
+/*
+ * Requantize
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, Requantize> {
+public:
+  CPU_ATTR CallbackImpl(const Requantize& config) : config(config) {
+    multiplier = set1_epi32<vi>(config.scale.multiplier);
+    rounding = set1_epi64<vi>(int64_t(1) << (config.scale.right_shift - 1));
+    right_shift = _mm_cvtsi32_si128(config.scale.right_shift);
+  }
+
+  CPU_ATTR vi operator()(vi input, const OutputBufferInfo&) {
+    return kernels::requantize(input, multiplier, rounding, right_shift);
+  }
+
+private:
+  Requantize config;
+  vi multiplier;
+  vi rounding;
+  __m128i right_shift;
+};
+
+/*
+ * RequantizeAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, RequantizeAndWrite> {
+public:
+  CPU_ATTR CallbackImpl(const RequantizeAndWrite& config) : config(config) {
+    multiplier = set1_epi32<vi>(config.scale.multiplier);
+    rounding = set1_epi64<vi>(int64_t(1) << (config.scale.right_shift - 1));
+    right_shift = _mm_cvtsi32_si128(config.scale.right_shift);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::requantize(input, multiplier, rounding, right_shift);
+    kernels::write_saturated(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+
+private:
+  RequantizeAndWrite config;
+  vi multiplier;
+  vi rounding;
+  __m128i right_shift;
+};
+
+/*
+ * AddBiasAndRequantizeAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, AddBiasAndRequantizeAndWrite> {
+public:
+  CPU_ATTR CallbackImpl(const AddBiasAndRequantizeAndWrite& config) : config(config) {
+    multiplier = set1_epi32<vi>(config.scale.multiplier);
+    rounding = set1_epi64<vi>(int64_t(1) << (config.scale.right_shift - 1));
+    right_shift = _mm_cvtsi32_si128(config.scale.right_shift);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::add_bias(input, config.bias_addr, info.col_idx);
+    result = kernels::requantize(result, multiplier, rounding, right_shift);
+    kernels::write_saturated(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+
+private:
+  AddBiasAndRequantizeAndWrite config;
+  vi multiplier;
+  vi rounding;
+  __m128i right_shift;
+};
+
 }
 }
 
+/*
+ * User-defined callbacks.
+ *
+ * Define INTGEMM_USER_CALLBACKS to the name of a file (e.g. -DINTGEMM_USER_CALLBACKS='"my_callbacks.inl"')
+ * before including intgemm and it is included here once per architecture, with CPU_NAME, CPU_ATTR, vi, vf
+ * and vd defined as above.  Specialize CallbackImpl<CPUType::CPU_NAME, YourConfig> there in the same way as
+ * the built-in callbacks, so the callback is compiled into every multiply kernel and fully inlined.  The file
+ * has no include guard; put the config structure in a separate header.
+ */
+#ifdef INTGEMM_USER_CALLBACKS
+#include INTGEMM_USER_CALLBACKS
+#endif
+
 #undef CPU_NAME
 #undef CPU_ATTR
 #undef vi
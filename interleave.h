@@ -6,7 +6,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdint.h>
+#include <vector>
 
 namespace intgemm {
 
@@ -102,6 +104,66 @@ INTGEMM_TRANSPOSE16(INTGEMM_AVX2, __m256i)
 INTGEMM_TRANSPOSE16(INTGEMM_AVX512BW, __m512i)
 #endif
 
+/* Transpose registers containing 4 packed 32-bit integers per 128-bit lane.
+ * Each 128-bit lane is handled independently.
+ */
+#define INTGEMM_TRANSPOSE32(target, Register) \
+target static inline void Transpose32InLane(Register &r0, Register &r1, Register &r2, Register &r3) { \
+  Interleave32(r0, r1); \
+  Interleave32(r2, r3); \
+  /* r0: columns 0 0 1 1 from rows 0 and 1 \
+     r1: columns 2 2 3 3 from rows 0 and 1 \
+     r2: columns 0 0 1 1 from rows 2 and 3 \
+     r3: columns 2 2 3 3 from rows 2 and 3*/ \
+  Interleave64(r0, r2); \
+  Interleave64(r1, r3); \
+  /* r0: column 0, r1: column 2, r2: column 1, r3: column 3 */ \
+  Swap(r1, r2); \
+} \
+
+INTGEMM_TRANSPOSE32(INTGEMM_SSE2, __m128i)
+INTGEMM_TRANSPOSE32(INTGEMM_AVX2, __m256i)
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+INTGEMM_TRANSPOSE32(INTGEMM_AVX512BW, __m512i)
+#endif
+
+/* Transpose a square tile of 32-bit values stored one row per register.
+ * Afterwards tile[i] holds column i.
+ */
+INTGEMM_SSE2 static inline void Transpose32(__m128i (&tile)[4]) {
+  Transpose32InLane(tile[0], tile[1], tile[2], tile[3]);
+}
+
+INTGEMM_AVX2 static inline void Transpose32(__m256i (&tile)[8]) {
+  Transpose32InLane(tile[0], tile[1], tile[2], tile[3]);
+  Transpose32InLane(tile[4], tile[5], tile[6], tile[7]);
+  // tile[i] holds columns i and 4 + i of rows 0-3, tile[4 + i] the same columns of rows 4-7.
+  for (int i = 0; i < 4; ++i) {
+    __m256i low = _mm256_permute2x128_si256(tile[i], tile[4 + i], 0x20);
+    tile[4 + i] = _mm256_permute2x128_si256(tile[i], tile[4 + i], 0x31);
+    tile[i] = low;
+  }
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+INTGEMM_AVX512BW static inline void Transpose32(__m512i (&tile)[16]) {
+  for (int g = 0; g < 16; g += 4) {
+    Transpose32InLane(tile[g], tile[g + 1], tile[g + 2], tile[g + 3]);
+  }
+  // Lane l of tile[4 * g + i] holds column 4 * l + i of rows 4 * g to 4 * g + 3.  Transpose the lanes.
+  for (int i = 0; i < 4; ++i) {
+    __m512i rows01_lanes01 = _mm512_shuffle_i32x4(tile[i], tile[4 + i], 0x44 /* = 1 0 1 0 */);
+    __m512i rows01_lanes23 = _mm512_shuffle_i32x4(tile[i], tile[4 + i], 0xee /* = 3 2 3 2 */);
+    __m512i rows23_lanes01 = _mm512_shuffle_i32x4(tile[8 + i], tile[12 + i], 0x44 /* = 1 0 1 0 */);
+    __m512i rows23_lanes23 = _mm512_shuffle_i32x4(tile[8 + i], tile[12 + i], 0xee /* = 3 2 3 2 */);
+    tile[i] = _mm512_shuffle_i32x4(rows01_lanes01, rows23_lanes01, 0x88 /* = 2 0 2 0 */);
+    tile[4 + i] = _mm512_shuffle_i32x4(rows01_lanes01, rows23_lanes01, 0xdd /* = 3 1 3 1 */);
+    tile[8 + i] = _mm512_shuffle_i32x4(rows01_lanes23, rows23_lanes23, 0x88 /* = 2 0 2 0 */);
+    tile[12 + i] = _mm512_shuffle_i32x4(rows01_lanes23, rows23_lanes23, 0xdd /* = 3 1 3 1 */);
+  }
+}
+#endif
+
 /* Tranpose registers containing 16 packed 8-bit integers.
  * Each 128-bit lane is handled independently.
  */
@@ -144,6 +206,29 @@ template <class Register> static inline void Transpose8InLane(
   r11 = tmp;
 }
 
+/* Column sums of a panel of 8 columns of prepared 8-bit B, holding rows rows
+ * in the layout of register_bytes: each register is rows of one column.
+ * Bytes are made unsigned to use sad, then the offset is taken off.
+ */
+INTGEMM_SSE2 static inline void PanelColumnSums(const int8_t *panel, Index rows, Index register_bytes, float *column_sums) {
+  const __m128i flip = _mm_set1_epi8(-128), zero = _mm_setzero_si128();
+  __m128i sums[8];
+  for (Index k = 0; k < 8; ++k) sums[k] = zero;
+  const __m128i *in = reinterpret_cast<const __m128i*>(panel);
+  const Index pieces = register_bytes / sizeof(__m128i);
+  for (Index r = 0; r < rows; r += register_bytes) {
+    for (Index k = 0; k < 8; ++k) {
+      for (Index p = 0; p < pieces; ++p, ++in) {
+        sums[k] = _mm_add_epi64(sums[k], _mm_sad_epu8(_mm_xor_si128(*in, flip), zero));
+      }
+    }
+  }
+  for (Index k = 0; k < 8; ++k) {
+    int sum = _mm_cvtsi128_si32(sums[k]) + _mm_cvtsi128_si32(_mm_srli_si128(sums[k], 8));
+    column_sums[k] = static_cast<float>(sum - 128 * static_cast<int>(rows));
+  }
+}
+
 // PREPARE B: quantize and rearrange.  B is presumed to be constantparameters
 // so we can take our time rearranging it in order to save during the multiply.
 //
@@ -178,20 +263,25 @@ template <class Register> static inline void Transpose8InLane(
 // 256 272
 // 257 273
 // ... ...
+// Each variant is split like Quantize: PrepareB opens #pragma omp parallel
+// and PrepareBRowsThread shares the panels of 8 columns with #pragma omp for, so
+// only plain types cross the parallel boundary (see AVX512_8bit::QuantizeThread).
 #define INTGEMM_PREPARE_B_8(target, QuantClass) \
-target static inline void PrepareB(const float *input, int8_t *output_shadow, float quant_mult, Index rows, Index cols) { \
+ private: \
+/* input points at rows [begin, begin + count) of B, which has rows rows in total. \
+ * If column_sums is not nullptr, it receives the sums of those rows of each column \
+ * of the output, computed while each panel is still in cache. */ \
+target static inline void PrepareBRowsThread(const float *input, int8_t *output_shadow, float quant_mult, Index rows, Index cols, Index begin, Index count, float *column_sums) { \
   typedef typename QuantClass Quantizer; \
   typedef typename Quantizer::Register Register; \
   Quantizer q = Quantizer(quant_mult); \
   /* Currently all multipliers have a stride of 8 columns.*/ \
   const int kColStride = 8; \
-  assert(cols % kColStride == 0); \
-  assert(rows % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  Register *output = reinterpret_cast<Register*>(output_shadow); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
+  _Pragma("omp for") \
   for (Index c = 0; c < cols; c += kColStride) { \
-    for (Index r = 0; r < rows; r += sizeof(Register), output += 8) { \
+    /* Each panel of 8 columns is rows / sizeof(Register) tiles of 8 registers. */ \
+    Register *output = reinterpret_cast<Register*>(output_shadow) + (c * rows + 8 * begin) / sizeof(Register); \
+    for (Index r = 0; r < count; r += sizeof(Register), output += 8) { \
       /* Quantize and perform a transpose with height sizeof(Register) and width 8. \
          This isn't quite Transpose8InLane because it's half the number of columns, \
          so each register starts with two rows instead of being one row. \
@@ -210,21 +300,60 @@ target static inline void PrepareB(const float *input, int8_t *output_shadow, fl
       Interleave8(output[6], output[7]); \
       Transpose16InLane(output[0], output[1], output[2], output[3], output[4], output[5], output[6], output[7]); \
     } \
+    if (column_sums) { \
+      PanelColumnSums(output_shadow + c * rows + 8 * begin, count, sizeof(Register), column_sums + c); \
+    } \
+  } \
+} \
+ public: \
+target static inline void PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) { \
+  assert(cols % 8 == 0); \
+  assert(rows % sizeof(typename QuantClass::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(typename QuantClass::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(typename QuantClass::Register) == 0); \
+  _Pragma("omp parallel") \
+  { \
+    PrepareBRowsThread(input, output, quant_mult, rows, cols, 0, rows, nullptr); \
+  } \
+} \
+/* PrepareB that also writes the sum of each column of output to column_sums. */ \
+target static inline void PrepareBColumnSums(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, float *column_sums) { \
+  assert(cols % 8 == 0); \
+  assert(rows % sizeof(typename QuantClass::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(typename QuantClass::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(typename QuantClass::Register) == 0); \
+  _Pragma("omp parallel") \
+  { \
+    PrepareBRowsThread(input, output, quant_mult, rows, cols, 0, rows, column_sums); \
+  } \
+} \
+/* Prepare rows [begin, begin + count) of B from just those rows of input, \
+ * writing their part of the full prepared output. */ \
+target static inline void PrepareBRows(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, Index begin, Index count) { \
+  assert(cols % 8 == 0); \
+  assert(begin % sizeof(typename QuantClass::Register) == 0); \
+  assert(count % sizeof(typename QuantClass::Register) == 0); \
+  assert(begin + count <= rows); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(typename QuantClass::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(typename QuantClass::Register) == 0); \
+  _Pragma("omp parallel") \
+  { \
+    PrepareBRowsThread(input, output, quant_mult, rows, cols, begin, count, nullptr); \
   } \
 } \
 
 #define INTGEMM_PREPARE_B_16(target, QuantClass) \
-target static inline void PrepareB(const float *input, int16_t *output_shadow, float quant_mult, Index rows, Index cols) { \
+ private: \
+/* input points at rows [begin, begin + count) of B, which has rows rows in total. */ \
+target static inline void PrepareBRowsThread(const float *input, int16_t *output_shadow, float quant_mult, Index rows, Index cols, Index begin, Index count) { \
   typedef typename QuantClass Quantizer; \
   typedef typename Quantizer::Register Register; \
   Quantizer q = Quantizer(quant_mult); \
-  assert(cols % 8 == 0); \
-  assert(rows % (sizeof(Register) / sizeof(int16_t)) == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  Register *output = reinterpret_cast<Register*>(output_shadow); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
+  const Index kRegisterElems = sizeof(Register) / sizeof(int16_t); \
+  _Pragma("omp for") \
   for (Index c = 0; c < cols; c += 8) { \
-    for (Index r = 0; r < rows; r += (sizeof(Register) / sizeof(int16_t)), output += 8) { \
+    Register *output = reinterpret_cast<Register*>(output_shadow) + (c * rows + 8 * begin) / kRegisterElems; \
+    for (Index r = 0; r < count; r += kRegisterElems, output += 8) { \
       /* gcc unrolls this loop and uses registers for output[k]*/ \
       for (int k = 0; k < 8; ++k) { \
         output[k] = q.ForReshape(input + cols * (r + k) + c, cols); \
@@ -232,6 +361,31 @@ target static inline void PrepareB(const float *input, int16_t *output_shadow, f
       Transpose16InLane(output[0], output[1], output[2], output[3], output[4], output[5], output[6], output[7]); \
     } \
   } \
+} \
+ public: \
+target static inline void PrepareB(const float *input, int16_t *output, float quant_mult, Index rows, Index cols) { \
+  assert(cols % 8 == 0); \
+  assert(rows % (sizeof(typename QuantClass::Register) / sizeof(int16_t)) == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(typename QuantClass::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(typename QuantClass::Register) == 0); \
+  _Pragma("omp parallel") \
+  { \
+    PrepareBRowsThread(input, output, quant_mult, rows, cols, 0, rows); \
+  } \
+} \
+/* Prepare rows [begin, begin + count) of B from just those rows of input, \
+ * writing their part of the full prepared output. */ \
+target static inline void PrepareBRows(const float *input, int16_t *output, float quant_mult, Index rows, Index cols, Index begin, Index count) { \
+  assert(cols % 8 == 0); \
+  assert(begin % (sizeof(typename QuantClass::Register) / sizeof(int16_t)) == 0); \
+  assert(count % (sizeof(typename QuantClass::Register) / sizeof(int16_t)) == 0); \
+  assert(begin + count <= rows); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(typename QuantClass::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(typename QuantClass::Register) == 0); \
+  _Pragma("omp parallel") \
+  { \
+    PrepareBRowsThread(input, output, quant_mult, rows, cols, begin, count); \
+  } \
 }
 
 /*
@@ -242,21 +396,30 @@ target static inline void PrepareB(const float *input, int16_t *output_shadow, f
  * cols and rows describe size of transposed B.
  */
 #define INTGEMM_PREPARE_B_QUANTIZED_TRANSPOSED(target, cpu_type, Integer) \
-target static inline void PrepareBQuantizedTransposed(const Integer* input, Integer* output, Index cols, Index rows) { \
+ private: \
+target static inline void PrepareBQuantizedTransposedThread(const Integer* input, Integer* output, Index cols, Index rows) { \
   using Register = vector_t<cpu_type, Integer>; \
   const Index RegisterElems = sizeof(Register) / sizeof(Integer); \
   const Index kColStride = 8; \
   \
-  assert(cols % RegisterElems == 0); \
-  assert(rows % kColStride == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
-  \
-  Register* output_it = reinterpret_cast<Register*>(output); \
-  for (Index r = 0; r < rows; r += kColStride) \
+  _Pragma("omp for") \
+  for (Index r = 0; r < rows; r += kColStride) { \
+    Register* output_it = reinterpret_cast<Register*>(output) + r * (cols / RegisterElems); \
     for (Index c = 0; c < cols; c += RegisterElems) \
       for (Index ri = 0; ri < 8; ++ri) \
         *output_it++ = *reinterpret_cast<const Register*>(input + (r + ri) * cols + c); \
+  } \
+} \
+ public: \
+target static inline void PrepareBQuantizedTransposed(const Integer* input, Integer* output, Index cols, Index rows) { \
+  assert(cols % (sizeof(vector_t<cpu_type, Integer>) / sizeof(Integer)) == 0); \
+  assert(rows % 8 == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(vector_t<cpu_type, Integer>) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(vector_t<cpu_type, Integer>) == 0); \
+  _Pragma("omp parallel") \
+  { \
+    PrepareBQuantizedTransposedThread(input, output, cols, rows); \
+  } \
 }
 
 /*
@@ -267,28 +430,34 @@ target static inline void PrepareBQuantizedTransposed(const Integer* input, Inte
  * cols and rows describe size of transposed B.
  */
 #define INTGEMM_PREPARE_B_TRANSPOSED(target, Quantizer, Integer) \
-target static inline void PrepareBTransposed(const float* input, Integer* output, float quant_mult, Index cols, Index rows) { \
+ private: \
+target static inline void PrepareBTransposedThread(const float* input, Integer* output, float quant_mult, Index cols, Index rows) { \
   using Register = typename Quantizer::Register; \
   const Index RegisterElemsInt = sizeof(Register) / sizeof(Integer); \
   const Index kColStride = 8; \
   \
-  assert(cols % (sizeof(Register) / sizeof(float)) == 0); \
-  assert(rows % kColStride == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
-  \
   Quantizer quantizer(quant_mult); \
-  Register* output_it = reinterpret_cast<Register*>(output); \
-  Index r = 0; \
-  Index c = 0; \
-  while (r < rows) { \
+  /* Group g is 8 registers starting at element g * RegisterElemsInt of the \
+     rows / 8 bands of 8 rows, where a register may wrap to the next row. */ \
+  const Index groups = rows / kColStride * cols / RegisterElemsInt; \
+  _Pragma("omp for") \
+  for (Index g = 0; g < groups; ++g) { \
+    Register* output_it = reinterpret_cast<Register*>(output) + 8 * g; \
+    const Index r = g * RegisterElemsInt / cols * kColStride; \
+    const Index c = g * RegisterElemsInt % cols; \
     for (Index ri = 0; ri < 8; ++ri) \
       *output_it++ = quantizer.ConsecutiveWithWrapping(input + (r + ri) * cols + c, cols - c, cols, 8); \
-    c += RegisterElemsInt; \
-    while (c >= cols) { \
-      r += kColStride; \
-      c -= cols; \
-    } \
+  } \
+} \
+ public: \
+target static inline void PrepareBTransposed(const float* input, Integer* output, float quant_mult, Index cols, Index rows) { \
+  assert(cols % (sizeof(typename Quantizer::Register) / sizeof(float)) == 0); \
+  assert(rows % 8 == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(typename Quantizer::Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(typename Quantizer::Register) == 0); \
+  _Pragma("omp parallel") \
+  { \
+    PrepareBTransposedThread(input, output, quant_mult, cols, rows); \
   } \
 }
 
@@ -314,4 +483,228 @@ target static inline void SelectColumnsOfB(const Register *input, Register *outp
   } \
 }
 
+/* Convert prepared B between the layouts of different register widths
+ * (PreparedBLayout) without requantizing.  In the PrepareB format each group of
+ * 8 columns is stored as runs of register-width bytes of rows: 8 registers, one
+ * per column, then the next run of rows.  Only the run length differs between
+ * CPUs, so converting copies pieces of the shorter run length.
+ */
+template <Index kPiece> static inline void RelayoutBPieces(const char *input, char *output, Index rows_bytes, Index cols, Index from_bytes, Index to_bytes) {
+  for (Index c = 0; c < cols; c += 8) {
+    const char *in_group = input + c * rows_bytes;
+    char *out_group = output + c * rows_bytes;
+    for (Index r = 0; r < rows_bytes; r += kPiece) {
+      const char *in = in_group + (r / from_bytes) * 8 * from_bytes + r % from_bytes;
+      char *out = out_group + (r / to_bytes) * 8 * to_bytes + r % to_bytes;
+      for (Index k = 0; k < 8; ++k) {
+        std::memcpy(out + k * to_bytes, in + k * from_bytes, kPiece);
+      }
+    }
+  }
+}
+
+// rows_bytes is the number of bytes in a column of B (rows * sizeof(Integer))
+// and must be a multiple of both register widths.
+static inline void RelayoutB(const void *input, void *output, Index rows_bytes, Index cols, Index from_bytes, Index to_bytes) {
+  assert(cols % 8 == 0);
+  assert(rows_bytes % from_bytes == 0 && rows_bytes % to_bytes == 0);
+  const char *in = static_cast<const char*>(input);
+  char *out = static_cast<char*>(output);
+  if (from_bytes == to_bytes) {
+    std::memcpy(out, in, std::size_t(rows_bytes) * cols);
+  } else if (std::min(from_bytes, to_bytes) == 16) {
+    RelayoutBPieces<16>(in, out, rows_bytes, cols, from_bytes, to_bytes);
+  } else {
+    RelayoutBPieces<32>(in, out, rows_bytes, cols, from_bytes, to_bytes);
+  }
+}
+
+/* Inverse of PrepareB: prepared B in the layout of register_bytes
+ * (PreparedBLayout) back to row-major or transposed integers.  Every 16 bytes
+ * of a register hold consecutive rows of one column, so any layout can be
+ * taken apart in 16-byte pieces: UnprepareBTransposed copies whole runs and
+ * UnprepareB transposes 8 pieces (one per column) at a time.
+ */
+static inline void UnprepareBTransposed(const void *input, void *output, Index rows_bytes, Index cols, Index register_bytes) {
+  assert(cols % 8 == 0);
+  assert(rows_bytes % register_bytes == 0);
+  const char *in = static_cast<const char*>(input);
+  char *out = static_cast<char*>(output);
+  for (Index c = 0; c < cols; c += 8) {
+    for (Index r = 0; r < rows_bytes; r += register_bytes) {
+      for (Index k = 0; k < 8; ++k, in += register_bytes) {
+        std::memcpy(out + (c + k) * rows_bytes + r, in, register_bytes);
+      }
+    }
+  }
+}
+
+INTGEMM_SSE2 static inline void UnprepareB(const int8_t *input, int8_t *output, Index rows, Index cols, Index register_bytes) {
+  assert(cols % 8 == 0);
+  assert(rows % register_bytes == 0);
+  // Row runs outside so the rows being written stay in cache.
+  for (Index r = 0; r < rows; r += register_bytes) {
+    for (Index c = 0; c < cols; c += 8) {
+      for (Index piece = 0; piece < register_bytes; piece += 16) {
+        const __m128i *in = reinterpret_cast<const __m128i*>(input + c * rows + 8 * r + piece);
+        const Index step = register_bytes / sizeof(__m128i);
+        __m128i r0 = _mm_loadu_si128(in), r1 = _mm_loadu_si128(in + step);
+        __m128i r2 = _mm_loadu_si128(in + 2 * step), r3 = _mm_loadu_si128(in + 3 * step);
+        __m128i r4 = _mm_loadu_si128(in + 4 * step), r5 = _mm_loadu_si128(in + 5 * step);
+        __m128i r6 = _mm_loadu_si128(in + 6 * step), r7 = _mm_loadu_si128(in + 7 * step);
+        // r0, r2, r4, r6: columns 01, 23, 45, 67 of rows 0-7; r1, r3, r5, r7 of rows 8-15.
+        Interleave8(r0, r1);
+        Interleave8(r2, r3);
+        Interleave8(r4, r5);
+        Interleave8(r6, r7);
+        // r0, r4: columns 0-3 and 4-7 of rows 0-3; r2, r6 of rows 4-7.
+        Interleave16(r0, r2);
+        Interleave16(r4, r6);
+        Interleave16(r1, r3);
+        Interleave16(r5, r7);
+        // All 8 columns of two rows per register.
+        Interleave32(r0, r4);
+        Interleave32(r2, r6);
+        Interleave32(r1, r5);
+        Interleave32(r3, r7);
+        int8_t *out = output + (r + piece) * cols + c;
+        const __m128i rows_in_order[8] = {r0, r4, r2, r6, r1, r5, r3, r7};
+        for (Index i = 0; i < 8; ++i) {
+          _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 2 * i * cols), rows_in_order[i]);
+          _mm_storel_epi64(reinterpret_cast<__m128i*>(out + (2 * i + 1) * cols), _mm_unpackhi_epi64(rows_in_order[i], rows_in_order[i]));
+        }
+      }
+    }
+  }
+}
+
+INTGEMM_SSE2 static inline void UnprepareB(const int16_t *input, int16_t *output, Index rows, Index cols, Index register_bytes) {
+  assert(cols % 8 == 0);
+  const Index register_elems = register_bytes / sizeof(int16_t);
+  assert(rows % register_elems == 0);
+  for (Index r = 0; r < rows; r += register_elems) {
+    for (Index c = 0; c < cols; c += 8) {
+      for (Index piece = 0; piece < register_elems; piece += 8) {
+        const __m128i *in = reinterpret_cast<const __m128i*>(input + c * rows + 8 * r + piece);
+        const Index step = register_bytes / sizeof(__m128i);
+        __m128i r0 = _mm_loadu_si128(in), r1 = _mm_loadu_si128(in + step);
+        __m128i r2 = _mm_loadu_si128(in + 2 * step), r3 = _mm_loadu_si128(in + 3 * step);
+        __m128i r4 = _mm_loadu_si128(in + 4 * step), r5 = _mm_loadu_si128(in + 5 * step);
+        __m128i r6 = _mm_loadu_si128(in + 6 * step), r7 = _mm_loadu_si128(in + 7 * step);
+        Transpose16InLane(r0, r1, r2, r3, r4, r5, r6, r7);
+        int16_t *out = output + (r + piece) * cols + c;
+        storeu_si(reinterpret_cast<__m128i*>(out), r0);
+        storeu_si(reinterpret_cast<__m128i*>(out + cols), r1);
+        storeu_si(reinterpret_cast<__m128i*>(out + 2 * cols), r2);
+        storeu_si(reinterpret_cast<__m128i*>(out + 3 * cols), r3);
+        storeu_si(reinterpret_cast<__m128i*>(out + 4 * cols), r4);
+        storeu_si(reinterpret_cast<__m128i*>(out + 5 * cols), r5);
+        storeu_si(reinterpret_cast<__m128i*>(out + 6 * cols), r6);
+        storeu_si(reinterpret_cast<__m128i*>(out + 7 * cols), r7);
+      }
+    }
+  }
+}
+
+/* PrepareB of B that is already quantized, in row-major order, into the layout
+ * of register_bytes: the inverse of UnprepareB, transposing 16 rows (8 for
+ * 16-bit) of 8 columns at a time.
+ */
+INTGEMM_SSE2 static inline void PrepareBQuantized(const int8_t *input, int8_t *output, Index rows, Index cols, Index register_bytes) {
+  assert(cols % 8 == 0);
+  assert(rows % register_bytes == 0);
+  for (Index r = 0; r < rows; r += register_bytes) {
+    for (Index c = 0; c < cols; c += 8) {
+      for (Index piece = 0; piece < register_bytes; piece += 16) {
+        const int8_t *in = input + (r + piece) * cols + c;
+        // Columns 0-7 of rows 2i and 2i + 1 as pairs of bytes.
+        __m128i pairs[8];
+        for (Index i = 0; i < 8; ++i) {
+          pairs[i] = _mm_unpacklo_epi8(
+              _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 2 * i * cols)),
+              _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + (2 * i + 1) * cols)));
+        }
+        // Each pair is 16 bits so this leaves 16 rows of one column per register.
+        Transpose16InLane(pairs[0], pairs[1], pairs[2], pairs[3], pairs[4], pairs[5], pairs[6], pairs[7]);
+        int8_t *out = output + c * rows + 8 * r + piece;
+        for (Index k = 0; k < 8; ++k) {
+          storeu_si(reinterpret_cast<__m128i*>(out + k * register_bytes), pairs[k]);
+        }
+      }
+    }
+  }
+}
+
+INTGEMM_SSE2 static inline void PrepareBQuantized(const int16_t *input, int16_t *output, Index rows, Index cols, Index register_bytes) {
+  assert(cols % 8 == 0);
+  const Index register_elems = register_bytes / sizeof(int16_t);
+  assert(rows % register_elems == 0);
+  for (Index r = 0; r < rows; r += register_elems) {
+    for (Index c = 0; c < cols; c += 8) {
+      for (Index piece = 0; piece < register_elems; piece += 8) {
+        const int16_t *in = input + (r + piece) * cols + c;
+        __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + cols));
+        __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * cols));
+        __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3 * cols));
+        __m128i r4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * cols));
+        __m128i r5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 5 * cols));
+        __m128i r6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 6 * cols));
+        __m128i r7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 7 * cols));
+        Transpose16InLane(r0, r1, r2, r3, r4, r5, r6, r7);
+        __m128i *out = reinterpret_cast<__m128i*>(output + c * rows + 8 * r + piece);
+        const Index step = register_bytes / sizeof(__m128i);
+        storeu_si(out, r0);
+        storeu_si(out + step, r1);
+        storeu_si(out + 2 * step, r2);
+        storeu_si(out + 3 * step, r3);
+        storeu_si(out + 4 * step, r4);
+        storeu_si(out + 5 * step, r5);
+        storeu_si(out + 6 * step, r6);
+        storeu_si(out + 7 * step, r7);
+      }
+    }
+  }
+}
+
+/* PrepareBQuantized that overwrites its input, needing one band of
+ * register_bytes / sizeof(Integer) rows as scratch instead of a second B.
+ * Preparing each band in place leaves B as bands of panels of 8 columns;
+ * prepared B is panels of bands, so the blocks of 8 registers are then
+ * transposed in place by following the cycles of the permutation.
+ */
+template <class Integer> static inline void PrepareBQuantizedInPlace(Integer *data, Index rows, Index cols, Index register_bytes) {
+  const Index band_rows = register_bytes / sizeof(Integer);
+  assert(cols % 8 == 0);
+  assert(rows % band_rows == 0);
+  std::vector<Integer> band(band_rows * cols);
+  for (Index r = 0; r < rows; r += band_rows) {
+    Integer *at = data + r * cols;
+    std::copy(at, at + band_rows * cols, band.begin());
+    PrepareBQuantized(band.data(), at, band_rows, cols, register_bytes);
+  }
+
+  // Block b * panels + p moves to p * bands + b.
+  const Index bands = rows / band_rows, panels = cols / 8, blocks = bands * panels;
+  if (bands == 1 || panels == 1) return;
+  const Index block_size = 8 * band_rows;
+  std::vector<bool> done(blocks, false);
+  std::vector<Integer> saved(block_size);
+  for (Index start = 0; start < blocks; ++start) {
+    if (done[start]) continue;
+    std::copy(data + start * block_size, data + (start + 1) * block_size, saved.begin());
+    Index to = start;
+    // The block that belongs at p * bands + b.
+    Index from = (to % bands) * panels + to / bands;
+    while (from != start) {
+      std::memcpy(data + to * block_size, data + from * block_size, block_size * sizeof(Integer));
+      done[to] = true;
+      to = from;
+      from = (to % bands) * panels + to / bands;
+    }
+    std::copy(saved.begin(), saved.end(), data + to * block_size);
+    done[to] = true;
+  }
+}
+
 } // namespace intgemm
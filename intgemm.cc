@@ -1,4 +1,11 @@
 #include "intgemm.h"
+#include "aligned.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
 
 namespace intgemm {
 
@@ -10,9 +17,220 @@ MeanStd Unsupported_VectorMeanStd(const float * /*begin*/, const float * /*end*/
   throw UnsupportedCPU();
 }
 
+void Unsupported_QuantizeZeroPoint(const float * /*input*/, uint8_t * /*output*/, float /*quant_mult*/, uint8_t /*zero_point*/, Index /*size*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_QuantizeColumnScaled(const float * /*input*/, int8_t * /*output*/, float /*quant_mult*/, const float * /*column_mults*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_QuantizeRowScaled(const float * /*input*/, int8_t * /*output*/, const float * /*row_mults*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_QuantizeRowScaled16(const float * /*input*/, int16_t * /*output*/, const float * /*row_mults*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+
+// Int8Shift::NormQuantizeU has no multiplier per row.
+void Unsupported_QuantizeRowScaledU(const float * /*input*/, uint8_t * /*output*/, const float * /*row_mults*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_RotateHadamard(float * /*data*/, const float * /*signs*/, Index /*block*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_QuantizeHadamard(const float * /*input*/, int8_t * /*output*/, float /*quant_mult*/, const float * /*signs*/, Index /*block*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_AbsoluteHistogram(const float * /*begin*/, const float * /*end*/, float /*bins_per_unit*/, Index /*bins*/, uint64_t * /*counts*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_RowStatistic(const float * /*input*/, Index /*rows*/, Index /*cols*/, Index /*stride*/, float * /*output*/) {
+  throw UnsupportedCPU();
+}
+
+void Unsupported_RowMeanStd(const float * /*input*/, Index /*rows*/, Index /*cols*/, Index /*stride*/, bool /*absolute*/, MeanStd * /*output*/) {
+  throw UnsupportedCPU();
+}
+
+float Unsupported_NormalizeRow(const float * /*input*/, const float * /*gamma*/, const float * /*beta*/, float /*mean*/, float /*scale*/, Index /*cols*/, float * /*output*/) {
+  throw UnsupportedCPU();
+}
+
+namespace {
+
+// Largest block of A quantized at once: 64 KiB of floats stays in L2 between
+// taking its maximum and quantizing it.
+const Index kQuantizeAutoBlock = 16384;
+
+/* Fused MaxAbsolute + Quantize.  Each block is quantized right after its
+ * maximum is known, using the maximum seen so far.  When a block raises the
+ * maximum, everything before it becomes stale; the stale prefix is quantized
+ * again with the final multiplier at the end.  So A is read once plus the part
+ * before the last increase of the maximum, instead of twice.
+ */
+template <typename Integer, float (*MaxAbsoluteFn)(const float *, const float *), void (*QuantizeFn)(const float *, Integer *, float, Index)>
+float QuantizeAutoImpl(const float *input, Integer *output, float max_quantized, Index size) {
+  float max = 0.0f;
+  float quant_mult = 1.0f;
+  Index stale = 0;
+  for (Index begin = 0; begin < size; begin += kQuantizeAutoBlock) {
+    Index length = std::min(kQuantizeAutoBlock, size - begin);
+    float block_max = MaxAbsoluteFn(input + begin, input + begin + length);
+    if (block_max > max) {
+      // Zeros quantize to zero with any multiplier, so only a nonzero maximum makes earlier blocks stale.
+      if (max > 0.0f) stale = begin;
+      max = block_max;
+      quant_mult = max_quantized / max;
+    }
+    QuantizeFn(input + begin, output + begin, quant_mult, length);
+  }
+  if (stale) QuantizeFn(input, output, quant_mult, stale);
+  return quant_mult;
+}
+
+// Statistics of rows for NormQuantizeImpl, turned into the mean to subtract
+// (0 for RMSNorm) in mean and the scale to multiply by in stddev.
+template <void (*RowMeanStdFn)(const float *, Index, Index, Index, bool, MeanStd *)>
+void NormScales(const float *input, Index rows, Index cols, float epsilon, bool rms, MeanStd *stats) {
+  RowMeanStdFn(input, rows, cols, cols, false, stats);
+  for (MeanStd *s = stats; s != stats + rows; ++s) {
+    float variance = s->stddev * s->stddev;
+    if (rms) {
+      variance += s->mean * s->mean;
+      s->mean = 0.0f;
+    }
+    s->stddev = 1.0f / std::sqrt(variance + epsilon);
+  }
+}
+
+/* Fused LayerNorm or RMSNorm + Quantize behind PrepareANorm.  A block of about
+ * kQuantizeAutoBlock floats gets its statistics, is normalized into a buffer
+ * and quantized from there while it is still in cache.  A global multiplier
+ * needs the maximum of everything first, so then A is normalized twice (the
+ * statistics are kept from the first pass).  With a multiplier per row
+ * (unquant_mults) the blocks are independent, so they are shared between
+ * threads once and quantized with QuantizeRowScaledFn, which has no OpenMP.
+ */
+template <typename Integer, void (*RowMeanStdFn)(const float *, Index, Index, Index, bool, MeanStd *), float (*NormalizeRowFn)(const float *, const float *, const float *, float, float, Index, float *), void (*QuantizeFn)(const float *, Integer *, float, Index), void (*QuantizeRowScaledFn)(const float *, Integer *, const float *, Index, Index)>
+float NormQuantizeImpl(const float *input, Integer *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, float max_quantized, float *unquant_mults, Index rows, Index cols) {
+  assert(cols * sizeof(Integer) % 64 == 0);
+  assert(!unquant_mults || max_quantized != 0.0f);
+  const Index block_rows = std::max<Index>(1, kQuantizeAutoBlock / cols);
+  if (unquant_mults) {
+#pragma omp parallel if(rows > block_rows)
+    {
+      AlignedVector<float> buffer(block_rows * cols);
+      std::vector<MeanStd> stats(block_rows);
+      std::vector<float> row_quant_mults(block_rows);
+#pragma omp for schedule(static)
+      for (Index begin = 0; begin < rows; begin += block_rows) {
+        Index count = std::min(block_rows, rows - begin);
+        NormScales<RowMeanStdFn>(input + begin * cols, count, cols, epsilon, rms, stats.data());
+        for (Index r = 0; r < count; ++r) {
+          float max = NormalizeRowFn(input + (begin + r) * cols, gamma, beta, stats[r].mean, stats[r].stddev, cols, buffer.begin() + r * cols);
+          row_quant_mults[r] = max > 0.0f ? max_quantized / max : 1.0f;
+          unquant_mults[begin + r] = 1.0f / row_quant_mults[r];
+        }
+        QuantizeRowScaledFn(buffer.begin(), output + begin * cols, row_quant_mults.data(), count, cols);
+      }
+    }
+    return 0.0f;
+  }
+  AlignedVector<float> buffer(block_rows * cols);
+  std::vector<MeanStd> stats(rows);
+  bool have_stats = false;
+  if (max_quantized != 0.0f) {
+    float max = 0.0f;
+    for (Index begin = 0; begin < rows; begin += block_rows) {
+      Index count = std::min(block_rows, rows - begin);
+      NormScales<RowMeanStdFn>(input + begin * cols, count, cols, epsilon, rms, &stats[begin]);
+      for (Index r = begin; r < begin + count; ++r) {
+        max = std::max(max, NormalizeRowFn(input + r * cols, gamma, beta, stats[r].mean, stats[r].stddev, cols, buffer.begin()));
+      }
+    }
+    quant_mult = max > 0.0f ? max_quantized / max : 1.0f;
+    have_stats = true;
+  }
+  for (Index begin = 0; begin < rows; begin += block_rows) {
+    Index count = std::min(block_rows, rows - begin);
+    if (!have_stats) NormScales<RowMeanStdFn>(input + begin * cols, count, cols, epsilon, rms, &stats[begin]);
+    for (Index r = 0; r < count; ++r) {
+      const MeanStd &s = stats[begin + r];
+      NormalizeRowFn(input + (begin + r) * cols, gamma, beta, s.mean, s.stddev, cols, buffer.begin() + r * cols);
+    }
+    QuantizeFn(buffer.begin(), output + begin * cols, quant_mult, count * cols);
+  }
+  return quant_mult;
+}
+
+// Floats per thread task in the parallel reductions; smaller inputs stay on
+// the calling thread.  A multiple of 16 keeps every chunk 64-byte aligned.
+const std::size_t kReduceChunk = 65536;
+
+template <float (*MaxAbsoluteFn)(const float *, const float *)>
+float ParallelMaxAbsolute(const float *begin, const float *end) {
+  const std::size_t size = end - begin;
+  if (size <= kReduceChunk) return MaxAbsoluteFn(begin, end);
+  const std::size_t chunks = (size + kReduceChunk - 1) / kReduceChunk;
+  float ret = 0.0f;
+#pragma omp parallel for reduction(max:ret) schedule(static)
+  for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+    const float *chunk_begin = begin + chunk * kReduceChunk;
+    ret = std::max(ret, MaxAbsoluteFn(chunk_begin, std::min(chunk_begin + kReduceChunk, end)));
+  }
+  return ret;
+}
+
+template <void (*VectorMomentsFn)(const float *, const float *, bool, double &, double &, double &)>
+MeanStd ParallelVectorMeanStd(const float *begin, const float *end, bool absolute) {
+  const std::size_t size = end - begin;
+  const std::size_t chunks = (size + kReduceChunk - 1) / kReduceChunk;
+  // count, mean and m2 of each chunk.
+  std::vector<double> partial(3 * chunks, 0.0);
+#pragma omp parallel for schedule(static) if(chunks > 1)
+  for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+    const float *chunk_begin = begin + chunk * kReduceChunk;
+    double *moments = &partial[3 * chunk];
+    VectorMomentsFn(chunk_begin, std::min(chunk_begin + kReduceChunk, end), absolute, moments[0], moments[1], moments[2]);
+  }
+  // Merge in order so the result does not depend on the number of threads.
+  double count = 0, mean = 0, m2 = 0;
+  for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+    CombineMeanStd(count, mean, m2, partial[3 * chunk], partial[3 * chunk + 1], partial[3 * chunk + 2]);
+  MeanStd ret;
+  ret.mean = static_cast<float>(mean);
+  ret.stddev = static_cast<float>(std::sqrt(m2 / count));
+  return ret;
+}
+
+} // namespace
+
 void (*Int16::Quantize)(const float *input, int16_t *output, float quant_mult, Index size) = ChooseCPU(AVX512_16bit::Quantize, AVX512_16bit::Quantize, AVX2_16bit::Quantize, SSE2_16bit::Quantize, SSE2_16bit::Quantize, Unsupported_16bit::Quantize);
 
+float (*Int16::QuantizeAuto)(const float *input, int16_t *output, float max_quantized, Index size) = ChooseCPU(
+    QuantizeAutoImpl<int16_t, avx512f::MaxAbsolute, AVX512_16bit::Quantize>,
+    QuantizeAutoImpl<int16_t, avx512f::MaxAbsolute, AVX512_16bit::Quantize>,
+    QuantizeAutoImpl<int16_t, avx2::MaxAbsolute, AVX2_16bit::Quantize>,
+    QuantizeAutoImpl<int16_t, sse2::MaxAbsolute, SSE2_16bit::Quantize>,
+    QuantizeAutoImpl<int16_t, sse2::MaxAbsolute, SSE2_16bit::Quantize>,
+    QuantizeAutoImpl<int16_t, Unsupported_MaxAbsolute, Unsupported_16bit::Quantize>);
+
+float (*Int16::NormQuantize)(const float *input, int16_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, float max_quantized, float *unquant_mults, Index rows, Index cols) = ChooseCPU(
+    NormQuantizeImpl<int16_t, avx512f::RowMeanStd, avx512f::NormalizeRow, AVX512_16bit::Quantize, avx512f::QuantizeRowScaled16>,
+    NormQuantizeImpl<int16_t, avx512f::RowMeanStd, avx512f::NormalizeRow, AVX512_16bit::Quantize, avx512f::QuantizeRowScaled16>,
+    NormQuantizeImpl<int16_t, avx2::RowMeanStd, avx2::NormalizeRow, AVX2_16bit::Quantize, avx2::QuantizeRowScaled16>,
+    NormQuantizeImpl<int16_t, sse2::RowMeanStd, sse2::NormalizeRow, SSE2_16bit::Quantize, sse2::QuantizeRowScaled16>,
+    NormQuantizeImpl<int16_t, sse2::RowMeanStd, sse2::NormalizeRow, SSE2_16bit::Quantize, sse2::QuantizeRowScaled16>,
+    NormQuantizeImpl<int16_t, Unsupported_RowMeanStd, Unsupported_NormalizeRow, Unsupported_16bit::Quantize, Unsupported_QuantizeRowScaled16>);
+
 void (*Int16::PrepareB)(const float *input, int16_t *output, float quant_mult, Index rows, Index cols) = ChooseCPU(AVX512_16bit::PrepareB, AVX512_16bit::PrepareB, AVX2_16bit::PrepareB, SSE2_16bit::PrepareB, SSE2_16bit::PrepareB, Unsupported_16bit::PrepareB);
+void (*Int16::PrepareBRows)(const float *input, int16_t *output, float quant_mult, Index rows, Index cols, Index begin, Index count) = ChooseCPU(AVX512_16bit::PrepareBRows, AVX512_16bit::PrepareBRows, AVX2_16bit::PrepareBRows, SSE2_16bit::PrepareBRows, SSE2_16bit::PrepareBRows, Unsupported_16bit::PrepareBRows);
 
 void (*Int16::PrepareBQuantizedTransposed)(const int16_t *input, int16_t *output, Index inner, Index B_untransposed_cols) = ChooseCPU(AVX512_16bit::PrepareBQuantizedTransposed, AVX512_16bit::PrepareBQuantizedTransposed, AVX2_16bit::PrepareBQuantizedTransposed, SSE2_16bit::PrepareBQuantizedTransposed, SSE2_16bit::PrepareBQuantizedTransposed, Unsupported_16bit::PrepareBQuantizedTransposed);
 
@@ -26,7 +244,25 @@ void (*Int8::Quantize)(const float *input, int8_t *output, float quant_mult, Ind
 
 void (*Int8::QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size) = ChooseCPU(AVX512VNNI_8bit::QuantizeU, AVX512_8bit::QuantizeU, AVX2_8bit::QuantizeU, SSSE3_8bit::QuantizeU, Unsupported_8bit::QuantizeU, Unsupported_8bit::QuantizeU);
 
+float (*Int8::QuantizeAuto)(const float *input, int8_t *output, float max_quantized, Index size) = ChooseCPU(
+    QuantizeAutoImpl<int8_t, avx512f::MaxAbsolute, AVX512VNNI_8bit::Quantize>,
+    QuantizeAutoImpl<int8_t, avx512f::MaxAbsolute, AVX512_8bit::Quantize>,
+    QuantizeAutoImpl<int8_t, avx2::MaxAbsolute, AVX2_8bit::Quantize>,
+    QuantizeAutoImpl<int8_t, sse2::MaxAbsolute, SSSE3_8bit::Quantize>,
+    QuantizeAutoImpl<int8_t, Unsupported_MaxAbsolute, Unsupported_8bit::Quantize>,
+    QuantizeAutoImpl<int8_t, Unsupported_MaxAbsolute, Unsupported_8bit::Quantize>);
+
+float (*Int8::NormQuantize)(const float *input, int8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, float max_quantized, float *unquant_mults, Index rows, Index cols) = ChooseCPU(
+    NormQuantizeImpl<int8_t, avx512f::RowMeanStd, avx512f::NormalizeRow, AVX512VNNI_8bit::Quantize, avx512f::QuantizeRowScaled>,
+    NormQuantizeImpl<int8_t, avx512f::RowMeanStd, avx512f::NormalizeRow, AVX512_8bit::Quantize, avx512f::QuantizeRowScaled>,
+    NormQuantizeImpl<int8_t, avx2::RowMeanStd, avx2::NormalizeRow, AVX2_8bit::Quantize, avx2::QuantizeRowScaled>,
+    NormQuantizeImpl<int8_t, sse2::RowMeanStd, sse2::NormalizeRow, SSSE3_8bit::Quantize, sse2::QuantizeRowScaled>,
+    NormQuantizeImpl<int8_t, Unsupported_RowMeanStd, Unsupported_NormalizeRow, Unsupported_8bit::Quantize, Unsupported_QuantizeRowScaled>,
+    NormQuantizeImpl<int8_t, Unsupported_RowMeanStd, Unsupported_NormalizeRow, Unsupported_8bit::Quantize, Unsupported_QuantizeRowScaled>);
+
 void (*Int8::PrepareB)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) = ChooseCPU(AVX512VNNI_8bit::PrepareB, AVX512_8bit::PrepareB, AVX2_8bit::PrepareB, SSSE3_8bit::PrepareB, Unsupported_8bit::PrepareB, Unsupported_8bit::PrepareB);
+void (*Int8::PrepareBColumnSums)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, float *column_sums) = ChooseCPU(AVX512VNNI_8bit::PrepareBColumnSums, AVX512_8bit::PrepareBColumnSums, AVX2_8bit::PrepareBColumnSums, SSSE3_8bit::PrepareBColumnSums, Unsupported_8bit::PrepareBColumnSums, Unsupported_8bit::PrepareBColumnSums);
+void (*Int8::PrepareBRows)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, Index begin, Index count) = ChooseCPU(AVX512VNNI_8bit::PrepareBRows, AVX512_8bit::PrepareBRows, AVX2_8bit::PrepareBRows, SSSE3_8bit::PrepareBRows, Unsupported_8bit::PrepareBRows, Unsupported_8bit::PrepareBRows);
 
 void (*Int8::PrepareBQuantizedTransposed)(const int8_t *input, int8_t *output, Index inner, Index B_untransposed_cols) = ChooseCPU(AVX512_8bit::PrepareBQuantizedTransposed, AVX512_8bit::PrepareBQuantizedTransposed, AVX2_8bit::PrepareBQuantizedTransposed, SSSE3_8bit::PrepareBQuantizedTransposed, Unsupported_8bit::PrepareBQuantizedTransposed, Unsupported_8bit::PrepareBQuantizedTransposed);
 
@@ -34,17 +270,144 @@ void (*Int8::PrepareBTransposed)(const float *input, int8_t *output, float quant
 
 void (*Int8::SelectColumnsB)(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end) = ChooseCPU(AVX512VNNI_8bit::SelectColumnsB, AVX512_8bit::SelectColumnsB, AVX2_8bit::SelectColumnsB, SSSE3_8bit::SelectColumnsB, Unsupported_8bit::SelectColumnsB, Unsupported_8bit::SelectColumnsB);
 
+void Int8::PrepareAGrouped(const float *input, int8_t *output, float *scales, Index group_size, Index rows, Index cols) {
+  assert(group_size % 64 == 0 && cols % group_size == 0);
+  // Each group is a row of a (rows * groups) x group_size matrix.
+  const Index group_count = rows * (cols / group_size);
+  std::vector<float> quant_mult(group_count);
+  RowMaxAbsolute(input, group_count, group_size, group_size, quant_mult.data());
+  for (Index i = 0; i < group_count; ++i) {
+    quant_mult[i] = quant_mult[i] > 0.0f ? 127.0f / quant_mult[i] : 1.0f;
+    scales[i] = 1.0f / quant_mult[i];
+  }
+  QuantizeRowScaled(input, output, quant_mult.data(), group_count, group_size);
+}
+
+void Int8::PrepareBGrouped(const float *input, int8_t *output, float *scales, Index group_size, Index rows, Index cols) {
+  assert(group_size % 64 == 0 && rows % group_size == 0);
+  // Quantize each group of each column to [-127, 127] row-major into output,
+  // then rearrange it in place.
+  std::vector<float> quant_mult(cols);
+  for (Index g = 0; g < rows / group_size; ++g) {
+    const float *group = input + g * group_size * cols;
+    ColumnMaxAbsolute(group, group_size, cols, cols, quant_mult.data());
+    for (Index c = 0; c < cols; ++c) {
+      quant_mult[c] = quant_mult[c] > 0.0f ? 127.0f / quant_mult[c] : 1.0f;
+      scales[g * cols + c] = 1.0f / quant_mult[c];
+    }
+    QuantizeColumnScaled(group, output + g * group_size * cols, 1.0f, quant_mult.data(), group_size, cols);
+  }
+  PrepareBQuantizedInPlace(output, rows, cols);
+}
+
+Index Int8::SelectOutliers(const float *input, Index rows, Index cols, float threshold, Index *outliers, float *inlier_max) {
+  std::vector<float> max(cols);
+  ColumnMaxAbsolute(input, rows, cols, cols, max.data());
+  Index count = 0;
+  *inlier_max = 0.0f;
+  for (Index c = 0; c < cols; ++c) {
+    if (max[c] > threshold) {
+      outliers[count++] = c;
+    } else {
+      *inlier_max = std::max(*inlier_max, max[c]);
+    }
+  }
+  return count;
+}
+
+void Int8::PrepareAOutliers(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, const Index *outliers, Index count, float *outlier_values) {
+  // A multiplier of 0 zeroes the outlier columns while quantizing.
+  std::vector<float> column_mults(cols, 1.0f);
+  for (Index j = 0; j < count; ++j) column_mults[outliers[j]] = 0.0f;
+  QuantizeColumnScaled(input, output, quant_mult, column_mults.data(), rows, cols);
+  for (Index r = 0; r < rows; ++r) {
+    for (Index j = 0; j < count; ++j) {
+      outlier_values[r * count + j] = input[r * cols + outliers[j]];
+    }
+  }
+}
+
+void Int8::PrepareBSmooth(const float *input, int8_t *output, float quant_mult, const float *smooth, Index rows, Index cols) {
+  // Quantize row-major straight into output, then rearrange it in place.
+  std::vector<float> row_mults(rows);
+  for (Index r = 0; r < rows; ++r) row_mults[r] = quant_mult * smooth[r];
+  QuantizeRowScaled(input, output, row_mults.data(), rows, cols);
+  PrepareBQuantizedInPlace(output, rows, cols);
+}
+
+void (*Int8::QuantizeColumnScaled)(const float *input, int8_t *output, float quant_mult, const float *column_mults, Index rows, Index cols) = ChooseCPU(avx512f::QuantizeColumnScaled, avx512f::QuantizeColumnScaled, avx2::QuantizeColumnScaled, sse2::QuantizeColumnScaled, Unsupported_QuantizeColumnScaled, Unsupported_QuantizeColumnScaled);
+
+void (*Int8::QuantizeRowScaled)(const float *input, int8_t *output, const float *row_mults, Index rows, Index cols) = ChooseCPU(avx512f::QuantizeRowScaled, avx512f::QuantizeRowScaled, avx2::QuantizeRowScaled, sse2::QuantizeRowScaled, Unsupported_QuantizeRowScaled, Unsupported_QuantizeRowScaled);
+
+void Int8::PrepareBHadamard(const float *input, int8_t *output, float quant_mult, const float *signs, Index block, Index rows, Index cols) {
+  // Rotating the columns of B is rotating the rows of its transpose.  Each
+  // band of block rows rotates on its own, so only a band is transposed,
+  // rotated, transposed back and handed to PrepareBRows.
+  AlignedVector<float> transposed(block * cols), band(block * cols);
+  for (Index begin = 0; begin < rows; begin += block) {
+    const float *in = input + begin * cols;
+    // 8 columns (the width of a panel) at a time to stay within cache lines.
+    for (Index c0 = 0; c0 < cols; c0 += 8)
+      for (Index r = 0; r < block; ++r)
+        for (Index c = c0; c < c0 + 8; ++c)
+          transposed[c * block + r] = in[r * cols + c];
+    RotateHadamard(transposed.begin(), signs + begin, block, cols, block);
+    for (Index c0 = 0; c0 < cols; c0 += 8)
+      for (Index r = 0; r < block; ++r)
+        for (Index c = c0; c < c0 + 8; ++c)
+          band[r * cols + c] = transposed[c * block + r];
+    PrepareBRows(band.begin(), output, quant_mult, rows, cols, begin, block);
+  }
+}
+
+void (*Int8::QuantizeHadamard)(const float *input, int8_t *output, float quant_mult, const float *signs, Index block, Index rows, Index cols) = ChooseCPU(avx512f::QuantizeHadamard, avx512f::QuantizeHadamard, avx2::QuantizeHadamard, sse2::QuantizeHadamard, Unsupported_QuantizeHadamard, Unsupported_QuantizeHadamard);
+
 const char *const Int8::kName = ChooseCPU(AVX512VNNI_8bit::kName, AVX512_8bit::kName, AVX2_8bit::kName, SSSE3_8bit::kName, Unsupported_8bit::kName, Unsupported_8bit::kName);
 
 void (*Int8Shift::QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size) = ChooseCPU(AVX512VNNI_8bit::QuantizeU, AVX512_8bit::QuantizeU, AVX2_8bit::QuantizeU, SSSE3_8bit::QuantizeU, Unsupported_8bit::QuantizeU, Unsupported_8bit::QuantizeU);
 
+float (*Int8Shift::QuantizeUAuto)(const float *input, uint8_t *output, float max_quantized, Index size) = ChooseCPU(
+    QuantizeAutoImpl<uint8_t, avx512f::MaxAbsolute, AVX512VNNI_8bit::QuantizeU>,
+    QuantizeAutoImpl<uint8_t, avx512f::MaxAbsolute, AVX512_8bit::QuantizeU>,
+    QuantizeAutoImpl<uint8_t, avx2::MaxAbsolute, AVX2_8bit::QuantizeU>,
+    QuantizeAutoImpl<uint8_t, sse2::MaxAbsolute, SSSE3_8bit::QuantizeU>,
+    QuantizeAutoImpl<uint8_t, Unsupported_MaxAbsolute, Unsupported_8bit::QuantizeU>,
+    QuantizeAutoImpl<uint8_t, Unsupported_MaxAbsolute, Unsupported_8bit::QuantizeU>);
+
+float (*Int8Shift::NormQuantizeU)(const float *input, uint8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, float max_quantized, float *unquant_mults, Index rows, Index cols) = ChooseCPU(
+    NormQuantizeImpl<uint8_t, avx512f::RowMeanStd, avx512f::NormalizeRow, AVX512VNNI_8bit::QuantizeU, Unsupported_QuantizeRowScaledU>,
+    NormQuantizeImpl<uint8_t, avx512f::RowMeanStd, avx512f::NormalizeRow, AVX512_8bit::QuantizeU, Unsupported_QuantizeRowScaledU>,
+    NormQuantizeImpl<uint8_t, avx2::RowMeanStd, avx2::NormalizeRow, AVX2_8bit::QuantizeU, Unsupported_QuantizeRowScaledU>,
+    NormQuantizeImpl<uint8_t, sse2::RowMeanStd, sse2::NormalizeRow, SSSE3_8bit::QuantizeU, Unsupported_QuantizeRowScaledU>,
+    NormQuantizeImpl<uint8_t, Unsupported_RowMeanStd, Unsupported_NormalizeRow, Unsupported_8bit::QuantizeU, Unsupported_QuantizeRowScaledU>,
+    NormQuantizeImpl<uint8_t, Unsupported_RowMeanStd, Unsupported_NormalizeRow, Unsupported_8bit::QuantizeU, Unsupported_QuantizeRowScaledU>);
+
+void (*Int8Shift::QuantizeZeroPoint)(const float *input, uint8_t *output, float quant_mult, uint8_t zero_point, Index size) = ChooseCPU(avx512f::QuantizeZeroPoint, avx512f::QuantizeZeroPoint, avx2::QuantizeZeroPoint, sse2::QuantizeZeroPoint, Unsupported_QuantizeZeroPoint, Unsupported_QuantizeZeroPoint);
+
 const char *const Int8Shift::kName = ChooseCPU(AVX512VNNI_8bit::kName, AVX512_8bit::kName, AVX2_8bit::kName, SSSE3_8bit::kName, Unsupported_8bit::kName, Unsupported_8bit::kName);
 
 const CPUType kCPU = ChooseCPU(CPUType::AVX512VNNI, CPUType::AVX512BW, CPUType::AVX2, CPUType::SSSE3, CPUType::SSE2, CPUType::UNSUPPORTED);
 
-float (*MaxAbsolute)(const float *begin, const float *end) = ChooseCPU(avx512f::MaxAbsolute, avx512f::MaxAbsolute, avx2::MaxAbsolute, sse2::MaxAbsolute, sse2::MaxAbsolute, Unsupported_MaxAbsolute);
+float (*MaxAbsolute)(const float *begin, const float *end) = ChooseCPU(ParallelMaxAbsolute<avx512f::MaxAbsolute>, ParallelMaxAbsolute<avx512f::MaxAbsolute>, ParallelMaxAbsolute<avx2::MaxAbsolute>, ParallelMaxAbsolute<sse2::MaxAbsolute>, ParallelMaxAbsolute<sse2::MaxAbsolute>, Unsupported_MaxAbsolute);
+
+MeanStd (*VectorMeanStd)(const float *begin, const float *end, bool absolute) = ChooseCPU(ParallelVectorMeanStd<avx512f::VectorMoments>, ParallelVectorMeanStd<avx512f::VectorMoments>, ParallelVectorMeanStd<avx2::VectorMoments>, ParallelVectorMeanStd<sse2::VectorMoments>, ParallelVectorMeanStd<sse2::VectorMoments>, Unsupported_VectorMeanStd);
+
+void (*AbsoluteHistogram)(const float *begin, const float *end, float bins_per_unit, Index bins, uint64_t *counts) = ChooseCPU(avx512f::AbsoluteHistogram, avx512f::AbsoluteHistogram, avx2::AbsoluteHistogram, sse2::AbsoluteHistogram, sse2::AbsoluteHistogram, Unsupported_AbsoluteHistogram);
+
+void (*RowMaxAbsolute)(const float *input, Index rows, Index cols, Index stride, float *output) = ChooseCPU(avx512f::RowMaxAbsolute, avx512f::RowMaxAbsolute, avx2::RowMaxAbsolute, sse2::RowMaxAbsolute, sse2::RowMaxAbsolute, Unsupported_RowStatistic);
+
+void (*RowSum)(const float *input, Index rows, Index cols, Index stride, float *output) = ChooseCPU(avx512f::RowSum, avx512f::RowSum, avx2::RowSum, sse2::RowSum, sse2::RowSum, Unsupported_RowStatistic);
 
-MeanStd (*VectorMeanStd)(const float *begin, const float *end, bool absolute) = ChooseCPU(avx512f::VectorMeanStd, avx512f::VectorMeanStd, avx2::VectorMeanStd, sse2::VectorMeanStd, sse2::VectorMeanStd, Unsupported_VectorMeanStd);
+void (*RowMeanStd)(const float *input, Index rows, Index cols, Index stride, bool absolute, MeanStd *output) = ChooseCPU(avx512f::RowMeanStd, avx512f::RowMeanStd, avx2::RowMeanStd, sse2::RowMeanStd, sse2::RowMeanStd, Unsupported_RowMeanStd);
+
+void (*ColumnMaxAbsolute)(const float *input, Index rows, Index cols, Index stride, float *output) = ChooseCPU(avx512f::ColumnMaxAbsolute, avx512f::ColumnMaxAbsolute, avx2::ColumnMaxAbsolute, sse2::ColumnMaxAbsolute, sse2::ColumnMaxAbsolute, Unsupported_RowStatistic);
+
+void (*RotateHadamard)(float *data, const float *signs, Index block, Index rows, Index cols) = ChooseCPU(avx512f::RotateHadamard, avx512f::RotateHadamard, avx2::RotateHadamard, sse2::RotateHadamard, sse2::RotateHadamard, Unsupported_RotateHadamard);
+
+void HadamardSigns(uint32_t seed, Index size, float *signs) {
+  std::mt19937 gen(seed);
+  for (Index i = 0; i < size; ++i) signs[i] = (gen() & 1) ? -1.0f : 1.0f;
+}
 
 constexpr const char *const Unsupported_16bit::kName;
 constexpr const char *const Unsupported_8bit::kName;
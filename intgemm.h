@@ -40,11 +40,14 @@
  */
 
 // Yes, both headers due to the debacle about int32_t
+#include <algorithm>
 #include <cstdint>
 #include <stdint.h>
 
 #include "intgemm_config.h"
 #include "types.h"
+#include "interleave.h"
+#include "prepared_b.h"
 #include "sse2_gemm.h"
 #include "ssse3_gemm.h"
 #include "avx2_gemm.h"
@@ -66,6 +69,9 @@ struct Unsupported_16bit {
   static void PrepareB(const float *, int16_t *, float, Index, Index) {
     throw UnsupportedCPU();
   }
+  static void PrepareBRows(const float *, int16_t *, float, Index, Index, Index, Index) {
+    throw UnsupportedCPU();
+  }
   static void PrepareBQuantizedTransposed(const int16_t *, int16_t *, Index, Index) {
     throw UnsupportedCPU();
   }
@@ -101,6 +107,12 @@ struct Unsupported_8bit {
   static void PrepareB(const float *, int8_t *, float, Index, Index) {
     throw UnsupportedCPU();
   }
+  static void PrepareBRows(const float *, int8_t *, float, Index, Index, Index, Index) {
+    throw UnsupportedCPU();
+  }
+  static void PrepareBColumnSums(const float *, int8_t *, float, Index, Index, float *) {
+    throw UnsupportedCPU();
+  }
   template<class Callback>
   static void PrepareBias(const int8_t *, Index, Index, Callback) {
     throw UnsupportedCPU();
@@ -116,6 +128,10 @@ struct Unsupported_8bit {
   static void Multiply8Shift(const uint8_t *, const int8_t *, Index, Index, Index, Callback) {
     throw UnsupportedCPU();
   }
+  template <typename Callback>
+  static void MultiplyGrouped(const int8_t *, const int8_t *, const float *, const float *, Index, Index, Index, Index, Callback) {
+    throw UnsupportedCPU();
+  }
 
   constexpr static const char *const kName = "8-bit Unsupported";
 };
@@ -131,6 +147,42 @@ static inline float MaxAbsolute(const float * /*begin*/, const float * /*end*/)
 static inline MeanStd VectorMeanStd(const float * /*begin*/, const float * /*end*/, bool /*absolute*/) {
   throw UnsupportedCPU();
 }
+static inline void AbsoluteHistogram(const float * /*begin*/, const float * /*end*/, float /*bins_per_unit*/, Index /*bins*/, uint64_t * /*counts*/) {
+  throw UnsupportedCPU();
+}
+static inline void QuantizeZeroPoint(const float * /*input*/, uint8_t * /*output*/, float /*quant_mult*/, uint8_t /*zero_point*/, Index /*size*/) {
+  throw UnsupportedCPU();
+}
+static inline void RowMaxAbsolute(const float * /*input*/, Index /*rows*/, Index /*cols*/, Index /*stride*/, float * /*output*/) {
+  throw UnsupportedCPU();
+}
+static inline void RowSum(const float * /*input*/, Index /*rows*/, Index /*cols*/, Index /*stride*/, float * /*output*/) {
+  throw UnsupportedCPU();
+}
+static inline void ColumnMaxAbsolute(const float * /*input*/, Index /*rows*/, Index /*cols*/, Index /*stride*/, float * /*output*/) {
+  throw UnsupportedCPU();
+}
+static inline void QuantizeColumnScaled(const float * /*input*/, int8_t * /*output*/, float /*quant_mult*/, const float * /*column_mults*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+static inline void QuantizeRowScaled(const float * /*input*/, int8_t * /*output*/, const float * /*row_mults*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+static inline void QuantizeRowScaled16(const float * /*input*/, int16_t * /*output*/, const float * /*row_mults*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+static inline void RotateHadamard(float * /*data*/, const float * /*signs*/, Index /*block*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+static inline void QuantizeHadamard(const float * /*input*/, int8_t * /*output*/, float /*quant_mult*/, const float * /*signs*/, Index /*block*/, Index /*rows*/, Index /*cols*/) {
+  throw UnsupportedCPU();
+}
+static inline void RowMeanStd(const float * /*input*/, Index /*rows*/, Index /*cols*/, Index /*stride*/, bool /*absolute*/, MeanStd * /*output*/) {
+  throw UnsupportedCPU();
+}
+static inline float NormalizeRow(const float * /*input*/, const float * /*gamma*/, const float * /*beta*/, float /*mean*/, float /*scale*/, Index /*cols*/, float * /*output*/) {
+  throw UnsupportedCPU();
+}
 } //namespace
 #endif
 
@@ -251,10 +303,72 @@ struct Int8 {
   // A version that adds 127 to each number, making sure that all numbers are positive
   static void (*QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size);
 
+  // Like PrepareA with quant_mult = max_quantized / MaxAbsolute(A), in one
+  // pass over A plus a second read and quantize of the blocks before the last
+  // one that raised the maximum.  So the cost depends on where the maximum
+  // falls: one pass if it is in the first block, two if it is in the last.
+  // Returns the chosen quant_mult.
+  static inline float PrepareAAuto(const float *input, int8_t *output, Index rows, Index cols, float max_quantized = 127.0f) {
+    return QuantizeAuto(input, output, max_quantized, rows * cols);
+  }
+
+  // Quantize with quant_mult = max_quantized / MaxAbsolute(input, input + size) and return quant_mult
+  // (1 if input is all zeros).  Works block by block, so each block is still in cache when it is quantized.
+  static float (*QuantizeAuto)(const float *input, int8_t *output, float max_quantized, Index size);
+
+  /* LayerNorm and PrepareA in one pass over A.  Each row x becomes
+   * (x - mean(x)) / sqrt(var(x) + epsilon) * gamma + beta, or with rms set
+   * x / sqrt(mean(x^2) + epsilon) * gamma + beta (RMSNorm), and is quantized
+   * from an L2-sized buffer, so the normalized floats never go to memory.
+   * gamma and beta have cols entries; beta may be nullptr.  cols must be a
+   * multiple of 64.
+   */
+  static inline void PrepareANorm(const float *input, int8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, Index rows, Index cols) {
+    NormQuantize(input, output, gamma, beta, epsilon, rms, quant_mult, 0.0f, nullptr, rows, cols);
+  }
+
+  // Same with quant_mult = max_quantized / max |normalized A|, which is returned.
+  // This normalizes twice, but still reads A from memory once per pass instead
+  // of also writing and reading the normalized floats.
+  static inline float PrepareANormAuto(const float *input, int8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float max_quantized, Index rows, Index cols) {
+    return NormQuantize(input, output, gamma, beta, epsilon, rms, 0.0f, max_quantized, nullptr, rows, cols);
+  }
+
+  // Same with a multiplier per row: unquant_mults[row] receives 1 / that row's
+  // quant_mult.  Multiply with callbacks::UnquantizeRowsAndAddBiasAndWrite.
+  static inline void PrepareANormRows(const float *input, int8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float max_quantized, float *unquant_mults, Index rows, Index cols) {
+    NormQuantize(input, output, gamma, beta, epsilon, rms, 0.0f, max_quantized, unquant_mults, rows, cols);
+  }
+
+  // Backs the three above: quant_mult is used as given when max_quantized is
+  // 0, else chosen globally or, with unquant_mults, per row.  Returns the
+  // global quant_mult (0 per row).
+  static float (*NormQuantize)(const float *input, int8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, float max_quantized, float *unquant_mults, Index rows, Index cols);
+
   // Warning: the output of PrepareB depends on the CPU.
   // It will match the Multiply function on the same CPU though.
   static void (*PrepareB)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols);
 
+  // Streaming PrepareB for a B too large to hold in float: input holds only
+  // rows [begin, begin + count) of B, e.g. as read from a file, and those rows
+  // of the full rows x cols prepared output are written.  Calling it on
+  // consecutive chunks gives the same output as PrepareB, so peak memory is
+  // the prepared B plus one chunk of floats.  quant_mult must be known before
+  // the first chunk.  begin and count must be multiples of 64
+  // (tile_info.b_rows).
+  static void (*PrepareBRows)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, Index begin, Index count);
+
+  // PrepareB that also writes the sum of each column of the quantized B to
+  // column_sums (cols floats), computed while each panel is still in cache.
+  static void (*PrepareBColumnSums)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, float *column_sums);
+
+  // PrepareB into a PreparedB that records the shape, quant_mult, CPU and column sums.
+  static inline PreparedB<int8_t> PrepareBOwned(const float *input, float quant_mult, Index rows, Index cols) {
+    PreparedB<int8_t> prepared(rows, cols, quant_mult);
+    PrepareBColumnSums(input, prepared.begin(), quant_mult, rows, cols, prepared.ColumnSums());
+    return prepared;
+  }
+
   // Convert from a B that was already transposed (routine not provided) and
   // quantized (e.g. with Quantize) to the CPU-dependent format used for
   // Multiply.  This is useful for storing a quantized model on disk then in a
@@ -266,15 +380,159 @@ struct Int8 {
   // a quantized model on disk then in a CPU-independent fashion.
   static void (*PrepareBTransposed)(const float *input, int8_t *output, float quant_mul, Index inner, Index B_untransposed_cols);
 
+  // Convert B that is already quantized, in row-major order (rows x cols), to
+  // the CPU-dependent format used for Multiply, e.g. a quantized checkpoint.
+  // The InPlace variant overwrites input with the prepared B, using 64 rows
+  // of scratch instead of a second B.  Throws UnsupportedCPU if this CPU
+  // cannot do 8-bit multiplication.
+  static inline void PrepareBQuantized(const int8_t *input, int8_t *output, Index rows, Index cols) {
+    Index bytes = PreparedBLayout(kCPU, 1);
+    if (!bytes) throw UnsupportedCPU();
+    intgemm::PrepareBQuantized(input, output, rows, cols, bytes);
+  }
+  static inline void PrepareBQuantizedInPlace(int8_t *data, Index rows, Index cols) {
+    Index bytes = PreparedBLayout(kCPU, 1);
+    if (!bytes) throw UnsupportedCPU();
+    intgemm::PrepareBQuantizedInPlace(data, rows, cols, bytes);
+  }
+
   // Select columns from a prepared B matrix.  The number of selected columns must be a multiple of 8.
   static void (*SelectColumnsB)(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end);
 
+  // Convert B prepared on a from CPU to the layout of a to CPU, e.g. a model
+  // prepared on AVX2 for serving on AVX512BW.  Only moves bytes, so it is
+  // exact.  rows must be a multiple of 64.  Throws UnsupportedCPU if either
+  // CPU cannot do 8-bit multiplication.
+  static inline void RelayoutB(const int8_t *input, int8_t *output, CPUType from, CPUType to, Index rows, Index cols) {
+    Index from_bytes = PreparedBLayout(from, 1), to_bytes = PreparedBLayout(to, 1);
+    if (!from_bytes || !to_bytes) throw UnsupportedCPU();
+    intgemm::RelayoutB(input, output, rows, cols, from_bytes, to_bytes);
+  }
+
+  // Inverse of PrepareB on a from CPU: the quantized B in row-major order
+  // (rows x cols), or transposed (cols x rows) as PrepareBQuantizedTransposed
+  // takes it.  Throws UnsupportedCPU like RelayoutB.
+  static inline void UnprepareB(const int8_t *input, int8_t *output, CPUType from, Index rows, Index cols) {
+    Index from_bytes = PreparedBLayout(from, 1);
+    if (!from_bytes) throw UnsupportedCPU();
+    intgemm::UnprepareB(input, output, rows, cols, from_bytes);
+  }
+  static inline void UnprepareBTransposed(const int8_t *input, int8_t *output, CPUType from, Index rows, Index cols) {
+    Index from_bytes = PreparedBLayout(from, 1);
+    if (!from_bytes) throw UnsupportedCPU();
+    intgemm::UnprepareBTransposed(input, output, rows, cols, from_bytes);
+  }
+
   // Multiply C = A * B, presuming A and B have been prepared.
   template <typename Callback>
   static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
     MultiplyImpl<Callback>::run(A, B, A_rows, width, B_cols, callback);
   }
 
+  // Multiply by a PreparedB, which supplies width and B_cols.  Throws
+  // PreparedBLayoutMismatch if B was prepared for another register width.
+  template <typename Callback>
+  static void Multiply(const int8_t *A, const PreparedB<int8_t> &B, Index A_rows, Callback callback) {
+    B.CheckLayout();
+    MultiplyImpl<Callback>::run(A, B.get(), A_rows, B.Rows(), B.Cols(), callback);
+  }
+
+  /* Group-wise quantization: the shared dimension (width) is cut into groups
+   * of group_size, a multiple of 64, and every group gets its own scale so
+   * that an outlier only coarsens its own group.
+   */
+  // Quantize each group of group_size consecutive values in each row of A with
+  // its own multiplier.  scales (rows x cols / group_size) receives the
+  // unquantization multipliers.
+  static void PrepareAGrouped(const float *input, int8_t *output, float *scales, Index group_size, Index rows, Index cols);
+
+  // PrepareB with a multiplier per group of group_size rows and per column.
+  // scales (rows / group_size x cols) receives the unquantization multipliers.
+  static void PrepareBGrouped(const float *input, int8_t *output, float *scales, Index group_size, Index rows, Index cols);
+
+  // C = sum over groups of A_scales[row][group] * B_scales[group][col] * (A * B within the group).
+  // A_scales may be nullptr when A was quantized per tensor; then fold its
+  // multiplier into B_scales.  The callback receives floats, e.g. callbacks::Write<float>.
+  template <typename Callback>
+  static void MultiplyGrouped(const int8_t *A, const int8_t *B, const float *A_scales, const float *B_scales, Index group_size, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyGroupedImpl<Callback>::run(A, B, A_scales, B_scales, group_size, A_rows, width, B_cols, callback);
+  }
+
+  /* Outlier decomposition: the few columns of A (the shared dimension) with
+   * values beyond a threshold are zeroed before quantization so they do not
+   * set quant_mult, and their contribution is added back in float by
+   * callbacks::UnquantizeAndAddOutliersAndBiasAndWrite:
+   *
+   *   Index count = Int8::SelectOutliers(A, rows, width, 6.0f, outliers, &inlier_max);
+   *   Int8::PrepareBOutliers(B, B_cols, outliers, count, outlier_B);  // Once, with B
+   *   float quant_mult = 127.0f / inlier_max;
+   *   Int8::PrepareAOutliers(A, A_prepared, quant_mult, rows, width, outliers, count, outlier_values);
+   *   Int8::Multiply(A_prepared, B_prepared, rows, width, B_cols, callbacks::UnquantizeAndAddOutliersAndBiasAndWrite(
+   *       1.0f / (quant_mult * B_quant_mult), outlier_values, count, outlier_B, bias, C));
+   *
+   * The outlier features are usually the same channels from batch to batch,
+   * so they can be selected on calibration data and only their count rows of
+   * the float B kept.
+   */
+  // Write to outliers, in increasing order, the columns of A holding a value
+  // whose magnitude exceeds threshold and return how many there are.
+  // inlier_max receives the largest magnitude in the other columns.
+  static Index SelectOutliers(const float *input, Index rows, Index cols, float threshold, Index *outliers, float *inlier_max);
+
+  // PrepareA with the outlier columns set to zero in the same pass.  Their
+  // float values are gathered into outlier_values (rows x count).
+  static void PrepareAOutliers(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, const Index *outliers, Index count, float *outlier_values);
+
+  // Gather rows outliers[0..count) of the float B (row-major, B_cols wide)
+  // into outlier_B (count x B_cols) for UnquantizeAndAddOutliersAndBiasAndWrite.
+  static inline void PrepareBOutliers(const float *input, Index B_cols, const Index *outliers, Index count, float *outlier_B) {
+    for (Index j = 0; j < count; ++j) {
+      std::copy(input + outliers[j] * B_cols, input + (outliers[j] + 1) * B_cols, outlier_B + j * B_cols);
+    }
+  }
+
+  /* Smoothing (SmoothQuant): dividing column k of A by smooth[k] and
+   * multiplying row k of B by it leaves A * B unchanged but moves the
+   * outliers of A into B, which quantizes better.  Pick smooth with
+   * SmoothingScales in calibration.h.
+   */
+  // PrepareB of B with row k multiplied by smooth[k].
+  static void PrepareBSmooth(const float *input, int8_t *output, float quant_mult, const float *smooth, Index rows, Index cols);
+
+  // PrepareA of A with column k multiplied by inverse_smooth[k] = 1 / smooth[k],
+  // in the same pass as quantization.
+  static inline void PrepareASmooth(const float *input, int8_t *output, float quant_mult, const float *inverse_smooth, Index rows, Index cols) {
+    QuantizeColumnScaled(input, output, quant_mult, inverse_smooth, rows, cols);
+  }
+
+  // Quantize a rows x cols matrix with a multiplier per column: output[r][c] =
+  // round(input[r][c] * quant_mult * column_mults[c]) saturated to [-127, 127].
+  static void (*QuantizeColumnScaled)(const float *input, int8_t *output, float quant_mult, const float *column_mults, Index rows, Index cols);
+
+  // Quantize a rows x cols matrix with a multiplier per row: output[r][c] =
+  // round(input[r][c] * row_mults[r]) saturated to [-127, 127].
+  static void (*QuantizeRowScaled)(const float *input, int8_t *output, const float *row_mults, Index rows, Index cols);
+
+  /* Hadamard rotation: each block of block values along the shared dimension
+   * (a power of 2, at least 64, dividing width) is multiplied by signs and by
+   * the Hadamard matrix divided by sqrt(block) in both A and B.  The product
+   * is unchanged, but outliers are spread over their block so per-tensor
+   * quant_mult loses less precision.  quant_mult applies to the rotated
+   * values; use RotateHadamard on float batches to calibrate it.
+   */
+  // PrepareA of the rotated A, in the same pass as quantization.
+  static inline void PrepareAHadamard(const float *input, int8_t *output, float quant_mult, const float *signs, Index block, Index rows, Index cols) {
+    QuantizeHadamard(input, output, quant_mult, signs, block, rows, cols);
+  }
+
+  // PrepareB of the rotated B.  signs and block must match PrepareAHadamard.
+  // Works a band of block rows at a time, so it needs two bands of floats, not
+  // a float copy of B.
+  static void PrepareBHadamard(const float *input, int8_t *output, float quant_mult, const float *signs, Index block, Index rows, Index cols);
+
+  // Rotate each row of input by blocks then quantize like Quantize.
+  static void (*QuantizeHadamard)(const float *input, int8_t *output, float quant_mult, const float *signs, Index block, Index rows, Index cols);
+
   static const char *const kName;
 
 private:
@@ -282,11 +540,19 @@ private:
   struct MultiplyImpl {
     static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
   };
+
+  template <typename Callback>
+  struct MultiplyGroupedImpl {
+    static void (*run)(const int8_t *A, const int8_t *B, const float *A_scales, const float *B_scales, Index group_size, Index A_rows, Index width, Index B_cols, Callback callback);
+  };
 };
 
 template <typename Callback>
 void (*Int8::MultiplyImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = ChooseCPU(OMPParallelWrap<Callback, AVX512VNNI_8bit>, OMPParallelWrap<Callback, AVX512_8bit>, OMPParallelWrap<Callback, AVX2_8bit>, OMPParallelWrap<Callback, SSSE3_8bit>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
 
+template <typename Callback>
+void (*Int8::MultiplyGroupedImpl<Callback>::run)(const int8_t *A, const int8_t *B, const float *A_scales, const float *B_scales, Index group_size, Index A_rows, Index width, Index B_cols, Callback callback) = ChooseCPU(OMPParallelWrapGrouped<Callback, AVX512VNNI_8bit>, OMPParallelWrapGrouped<Callback, AVX512_8bit>, OMPParallelWrapGrouped<Callback, AVX2_8bit>, OMPParallelWrapGrouped<Callback, SSSE3_8bit>, Unsupported_8bit::MultiplyGrouped<Callback>, Unsupported_8bit::MultiplyGrouped<Callback>);
+
 /*
  * 8-bit matrix multiplication with shifting A by 127
  */
@@ -304,6 +570,46 @@ struct Int8Shift {
   // Multiply floats by quant_mult then convert to 8-bit integers with saturation.
   // A version that adds 127 to each number, making sure that all numbers are positive
   static void (*QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size);
+
+  // Like PrepareA with quant_mult = max_quantized / MaxAbsolute(A), in one
+  // pass over A plus a second read and quantize of the blocks before the last
+  // one that raised the maximum.  So the cost depends on where the maximum
+  // falls: one pass if it is in the first block, two if it is in the last.
+  // Returns the chosen quant_mult.
+  static inline float PrepareAAuto(const float *input, int8_t *output, Index rows, Index cols, float max_quantized = 127.0f) {
+    return QuantizeUAuto(input, reinterpret_cast<uint8_t *>(output), max_quantized, rows * cols);
+  }
+
+  // QuantizeU with quant_mult = max_quantized / MaxAbsolute(input, input + size); returns quant_mult.
+  static float (*QuantizeUAuto)(const float *input, uint8_t *output, float max_quantized, Index size);
+
+  // Fused normalization and PrepareA; see Int8::PrepareANorm.  There is no
+  // multiplier per row because PrepareBias folds a single one into the bias.
+  static inline void PrepareANorm(const float *input, int8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, Index rows, Index cols) {
+    NormQuantizeU(input, reinterpret_cast<uint8_t *>(output), gamma, beta, epsilon, rms, quant_mult, 0.0f, nullptr, rows, cols);
+  }
+  static inline float PrepareANormAuto(const float *input, int8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float max_quantized, Index rows, Index cols) {
+    return NormQuantizeU(input, reinterpret_cast<uint8_t *>(output), gamma, beta, epsilon, rms, 0.0f, max_quantized, nullptr, rows, cols);
+  }
+  static float (*NormQuantizeU)(const float *input, uint8_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, float max_quantized, float *unquant_mults, Index rows, Index cols);
+
+  // Asymmetric version of PrepareA: round(A * quant_mult) + zero_point saturated to [0, 255].
+  // Pick zero_point so that the range of A uses all 256 levels, e.g. for A in [lo, hi]:
+  // quant_mult = 255 / (hi - lo), zero_point = round(-lo * quant_mult).
+  // Correct for the zero point with PrepareBiasZeroPoint.
+  static inline void PrepareAZeroPoint(const float *input, int8_t *output, float quant_mult, uint8_t zero_point, Index rows, Index cols) {
+    QuantizeZeroPoint(input, reinterpret_cast<uint8_t *>(output), quant_mult, zero_point, rows * cols);
+  }
+
+  // Same with a zero point per row of A.  Correct for the zero points with the
+  // UnquantizeAndSubtractZeroPointAndAddBiasAndWrite callback.
+  static inline void PrepareAZeroPoint(const float *input, int8_t *output, float quant_mult, const uint8_t *zero_points, Index rows, Index cols) {
+    for (Index r = 0; r < rows; ++r) {
+      QuantizeZeroPoint(input + r * cols, reinterpret_cast<uint8_t *>(output) + r * cols, quant_mult, zero_points[r], cols);
+    }
+  }
+
+  static void (*QuantizeZeroPoint)(const float *input, uint8_t *output, float quant_mult, uint8_t zero_point, Index size);
   
   // Warning: the output of PrepareB depends on the CPU.
   // It will match the Multiply function on the same CPU though.
@@ -311,11 +617,37 @@ struct Int8Shift {
     Int8::PrepareB(input, output, quant_mult, rows, cols);
   }
 
+  static void PrepareBRows(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, Index begin, Index count) {
+    Int8::PrepareBRows(input, output, quant_mult, rows, cols, begin, count);
+  }
+
+  static inline PreparedB<int8_t> PrepareBOwned(const float *input, float quant_mult, Index rows, Index cols) {
+    return Int8::PrepareBOwned(input, quant_mult, rows, cols);
+  }
+
   // Select columns from a prepared B matrix.  The number of selected columns must be a multiple of 8. 
   static void SelectColumnsB(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end) {
     Int8::SelectColumnsB(input, output, rows, cols_begin, cols_end);
   }
 
+  static inline void PrepareBQuantized(const int8_t *input, int8_t *output, Index rows, Index cols) {
+    Int8::PrepareBQuantized(input, output, rows, cols);
+  }
+  static inline void PrepareBQuantizedInPlace(int8_t *data, Index rows, Index cols) {
+    Int8::PrepareBQuantizedInPlace(data, rows, cols);
+  }
+
+  static inline void RelayoutB(const int8_t *input, int8_t *output, CPUType from, CPUType to, Index rows, Index cols) {
+    Int8::RelayoutB(input, output, from, to, rows, cols);
+  }
+
+  static inline void UnprepareB(const int8_t *input, int8_t *output, CPUType from, Index rows, Index cols) {
+    Int8::UnprepareB(input, output, from, rows, cols);
+  }
+  static inline void UnprepareBTransposed(const int8_t *input, int8_t *output, CPUType from, Index rows, Index cols) {
+    Int8::UnprepareBTransposed(input, output, from, rows, cols);
+  }
+
   // A slightly faster version compared to the Int8 one (assuming a bias is used) because of better handling of the sign bit
   // Multiply C = A * B + Bias, presuming A, B and Bias have all been prepared (for A, PrepareAnew should be used
   template<class Callback>
@@ -323,6 +655,26 @@ struct Int8Shift {
     MultiplyImpl<Callback>::run((const uint8_t *)A, B, A_rows, width, B_cols, callback);
   }
 
+  // Multiply by a PreparedB, which supplies width and B_cols, with the bias
+  // from PrepareBias(const PreparedB&, ...).  Throws PreparedBLayoutMismatch
+  // like Int8::Multiply.
+  template<class Callback>
+  static void Multiply(const int8_t *A, const PreparedB<int8_t> &B, Index A_rows, Callback callback) {
+    B.CheckLayout();
+    MultiplyImpl<Callback>::run((const uint8_t *)A, B.get(), A_rows, B.Rows(), B.Cols(), callback);
+  }
+
+  // PrepareBias from the column sums recorded by PrepareBOwned, so there is no
+  // pass over B: bias_out = bias - 127 * unquant_mult * (column sums of B),
+  // where unquant_mult is the one Multiply will use.  Compute it once per B
+  // and unquant_mult.  bias may be nullptr; bias_out may alias bias.
+  static inline void PrepareBias(const PreparedB<int8_t> &B, float unquant_mult, const float *bias, float *bias_out) {
+    const float *sums = B.ColumnSums();
+    for (Index c = 0; c < B.Cols(); ++c) {
+      bias_out[c] = (bias ? bias[c] : 0.0f) - 127.0f * unquant_mult * sums[c];
+    }
+  }
+
   // This function prepares the bias for the Multiply routine that does unsigned * signed multiplication.
   // The function takes:
   // a preparedB matrix, width, B_cols and
@@ -332,6 +684,19 @@ struct Int8Shift {
   static void PrepareBias(const int8_t *B, Index width, Index B_cols, Callback callback) {
     PrepareBiasImpl<Callback>::run(B, width, B_cols, callback);
   }
+
+  // PrepareBias for A prepared by PrepareAZeroPoint with a single zero_point:
+  // bias_out = bias - zero_point * unquant_mult * (column sums of B).  Then
+  // Multiply with UnquantizeAndAddBiasAndWrite(unquant_mult, bias_out, C).
+  // bias_out may alias bias.
+  static inline void PrepareBiasZeroPoint(const int8_t *B, Index width, Index B_cols, uint8_t zero_point, float unquant_mult, const float *bias, float *bias_out) {
+    PrepareBias(B, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(-unquant_mult * zero_point, bias, bias_out));
+  }
+
+  // Column sums of B as floats, for UnquantizeAndSubtractZeroPointAndAddBiasAndWrite.
+  static inline void PrepareColumnSums(const int8_t *B, Index width, Index B_cols, float *column_sums) {
+    PrepareBias(B, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, column_sums));
+  }
   
   static const char *const kName;
 
@@ -378,10 +743,46 @@ struct Int16 {
   // input
   static void (*Quantize)(const float *input, int16_t *output, float quant_mult, Index size);
 
+  // Like PrepareA with quant_mult = max_quantized / MaxAbsolute(A), in one
+  // pass over A plus a second read and quantize of the blocks before the last
+  // one that raised the maximum.  So the cost depends on where the maximum
+  // falls: one pass if it is in the first block, two if it is in the last.
+  // Returns the chosen quant_mult.  There is no default for max_quantized:
+  // it has to leave room for the 32-bit sums.
+  static inline float PrepareAAuto(const float *input, int16_t *output, Index rows, Index cols, float max_quantized) {
+    return QuantizeAuto(input, output, max_quantized, rows * cols);
+  }
+
+  // Quantize with quant_mult = max_quantized / MaxAbsolute(input, input + size) and return quant_mult.
+  static float (*QuantizeAuto)(const float *input, int16_t *output, float max_quantized, Index size);
+
+  // Fused normalization and PrepareA; see Int8::PrepareANorm.  cols must be a multiple of 32.
+  static inline void PrepareANorm(const float *input, int16_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, Index rows, Index cols) {
+    NormQuantize(input, output, gamma, beta, epsilon, rms, quant_mult, 0.0f, nullptr, rows, cols);
+  }
+  static inline float PrepareANormAuto(const float *input, int16_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float max_quantized, Index rows, Index cols) {
+    return NormQuantize(input, output, gamma, beta, epsilon, rms, 0.0f, max_quantized, nullptr, rows, cols);
+  }
+  static inline void PrepareANormRows(const float *input, int16_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float max_quantized, float *unquant_mults, Index rows, Index cols) {
+    NormQuantize(input, output, gamma, beta, epsilon, rms, 0.0f, max_quantized, unquant_mults, rows, cols);
+  }
+  static float (*NormQuantize)(const float *input, int16_t *output, const float *gamma, const float *beta, float epsilon, bool rms, float quant_mult, float max_quantized, float *unquant_mults, Index rows, Index cols);
+
   // Warning: the output of PrepareB depends on the CPU.
   // It will match the Multiply function on the same CPU though.
   static void (*PrepareB)(const float *input, int16_t *output, float quant_mult, Index rows, Index cols);
 
+  // Streaming PrepareB; see Int8::PrepareBRows.  begin and count must be
+  // multiples of 32.
+  static void (*PrepareBRows)(const float *input, int16_t *output, float quant_mult, Index rows, Index cols, Index begin, Index count);
+
+  // PrepareB into a PreparedB; see Int8::PrepareBOwned.  16-bit B has no column sums.
+  static inline PreparedB<int16_t> PrepareBOwned(const float *input, float quant_mult, Index rows, Index cols) {
+    PreparedB<int16_t> prepared(rows, cols, quant_mult);
+    PrepareB(input, prepared.begin(), quant_mult, rows, cols);
+    return prepared;
+  }
+
   // Convert from a B that was already transposed (routine not provided) and
   // quantized (e.g. with Quantize) to the CPU-dependent format used for
   // Multiply.  This is useful for storing a quantized model on disk then in a
@@ -393,15 +794,55 @@ struct Int16 {
   // a quantized model on disk then in a CPU-independent fashion.
   static void (*PrepareBTransposed)(const float *input, int16_t *output, float quant_mul, Index inner, Index B_untransposed_cols);
 
+  // Convert B that is already quantized, in row-major order, to the format
+  // used for Multiply; see Int8::PrepareBQuantized.
+  static inline void PrepareBQuantized(const int16_t *input, int16_t *output, Index rows, Index cols) {
+    Index bytes = PreparedBLayout(kCPU, 2);
+    if (!bytes) throw UnsupportedCPU();
+    intgemm::PrepareBQuantized(input, output, rows, cols, bytes);
+  }
+  static inline void PrepareBQuantizedInPlace(int16_t *data, Index rows, Index cols) {
+    Index bytes = PreparedBLayout(kCPU, 2);
+    if (!bytes) throw UnsupportedCPU();
+    intgemm::PrepareBQuantizedInPlace(data, rows, cols, bytes);
+  }
+
   // Select columns from a prepared B matrix.  The number of selected columns must be a multiple of 8. 
   static void (*SelectColumnsB)(const int16_t *input, int16_t *output, Index rows, const Index *cols_begin, const Index *cols_end);
 
+  // Convert B prepared on a from CPU to the layout of a to CPU; see
+  // Int8::RelayoutB.  rows must be a multiple of 32.
+  static inline void RelayoutB(const int16_t *input, int16_t *output, CPUType from, CPUType to, Index rows, Index cols) {
+    Index from_bytes = PreparedBLayout(from, 2), to_bytes = PreparedBLayout(to, 2);
+    if (!from_bytes || !to_bytes) throw UnsupportedCPU();
+    intgemm::RelayoutB(input, output, rows * 2, cols, from_bytes, to_bytes);
+  }
+
+  // Inverse of PrepareB; see Int8::UnprepareB.
+  static inline void UnprepareB(const int16_t *input, int16_t *output, CPUType from, Index rows, Index cols) {
+    Index from_bytes = PreparedBLayout(from, 2);
+    if (!from_bytes) throw UnsupportedCPU();
+    intgemm::UnprepareB(input, output, rows, cols, from_bytes);
+  }
+  static inline void UnprepareBTransposed(const int16_t *input, int16_t *output, CPUType from, Index rows, Index cols) {
+    Index from_bytes = PreparedBLayout(from, 2);
+    if (!from_bytes) throw UnsupportedCPU();
+    intgemm::UnprepareBTransposed(input, output, rows * 2, cols, from_bytes);
+  }
+
   // Multiply C = A * B, presuming A and B have been prepared.
   template <typename Callback>
   static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
     MultiplyImpl<Callback>::run(A, B, A_rows, width, B_cols, callback);
   }
 
+  // Multiply by a PreparedB; see Int8::Multiply.
+  template <typename Callback>
+  static void Multiply(const int16_t *A, const PreparedB<int16_t> &B, Index A_rows, Callback callback) {
+    B.CheckLayout();
+    MultiplyImpl<Callback>::run(A, B.get(), A_rows, B.Rows(), B.Cols(), callback);
+  }
+
   static const char *const kName;
 
 private:
@@ -417,9 +858,14 @@ void (*Int16::MultiplyImpl<Callback>::run)(const int16_t *A, const int16_t *B, I
 extern const CPUType kCPU;
 
 // Get the maximum absolute value of an array of floats. The number of floats must be a multiple of 16 and 64-byte aligned.
+// Large arrays are split across OpenMP threads.
 extern float (*MaxAbsolute)(const float *begin, const float *end);
 
 // Get a Quantization value that is equant to the mean of the data +N standard deviations. Use 2 by default
+// Large arrays are split into chunks across OpenMP threads.  Each chunk's
+// count, mean and sum of squared deviations stay in double and are merged
+// in order with the update of Chan, Golub and LeVeque, so the standard
+// deviation stays accurate when the mean is large.
 extern MeanStd (*VectorMeanStd)(const float *begin, const float *end, bool);
 
 /* Returns the Mean and the Standard deviation of a vector. 
@@ -428,5 +874,27 @@ static inline MeanStd GetVectorMeanStd(const float * begin, const float * end, b
   return VectorMeanStd(begin, end, absolute);
 }
 
+/* Per-row statistics of a rows x cols matrix whose rows start stride floats
+ * apart, in one call.  Rows need not be aligned and cols can be anything.
+ * output has one entry per row.
+ */
+extern void (*RowMaxAbsolute)(const float *input, Index rows, Index cols, Index stride, float *output);
+extern void (*RowSum)(const float *input, Index rows, Index cols, Index stride, float *output);
+// Like GetVectorMeanStd for each row.
+extern void (*RowMeanStd)(const float *input, Index rows, Index cols, Index stride, bool absolute, MeanStd *output);
+// Maximum absolute value of each column instead; output has one entry per column.
+extern void (*ColumnMaxAbsolute)(const float *input, Index rows, Index cols, Index stride, float *output);
+
+// Rotate each row of a rows x cols row-major matrix in place: every block of
+// block values is multiplied by signs, then by the Hadamard matrix divided by
+// sqrt(block).  See Int8::PrepareAHadamard.
+extern void (*RotateHadamard)(float *data, const float *signs, Index block, Index rows, Index cols);
+
+// Random signs (+1 or -1) for RotateHadamard, reproducible from seed.
+void HadamardSigns(uint32_t seed, Index size, float *signs);
+
+// Histogram of absolute values: ++counts[min(|x| * bins_per_unit, bins - 1)] for each x in [begin, end).
+// begin must be 64-byte aligned.  See calibration.h for a histogram that grows over many batches.
+extern void (*AbsoluteHistogram)(const float *begin, const float *end, float bins_per_unit, Index bins, uint64_t *counts);
 
 } // namespace intgemm
@@ -21,6 +21,7 @@ template <class Register> static inline Register load_ps(float const* from);
 template <class Register> static inline Register loadu_ps(const float* mem_addr);
 template <class Register> static inline Register set1_epi16(int16_t to);
 template <class Register> static inline Register set1_epi32(int32_t to);
+template <class Register> static inline Register set1_epi64(int64_t to);
 template <class Register> static inline Register set1_epi8(int8_t to);
 template <class Register> static inline Register set1_pd(double to);
 template <class Register> static inline Register set1_ps(float to);
@@ -45,6 +46,9 @@ INTGEMM_SSE2 static inline __m128i add_epi16(__m128i a, __m128i b) {
 INTGEMM_SSE2 static inline __m128i add_epi32(__m128i first, __m128i second) {
   return _mm_add_epi32(first, second);
 }
+INTGEMM_SSE2 static inline __m128i add_epi64(__m128i a, __m128i b) {
+  return _mm_add_epi64(a, b);
+}
 INTGEMM_SSE2 static inline __m128i adds_epi16(__m128i first, __m128i second) {
   return _mm_adds_epi16(first, second);
 }
@@ -126,6 +130,9 @@ INTGEMM_SSE2 static inline __m128i or_si(__m128i a, __m128i b) {
 INTGEMM_SSE2 static inline __m128i packs_epi16(__m128i a, __m128i b) {
   return _mm_packs_epi16(a, b);
 }
+INTGEMM_SSE2 static inline __m128i packus_epi16(__m128i a, __m128i b) {
+  return _mm_packus_epi16(a, b);
+}
 INTGEMM_SSE2 static inline __m128i packs_epi32(__m128i a, __m128i b) {
   return _mm_packs_epi32(a, b);
 }
@@ -138,6 +145,9 @@ template <> INTGEMM_SSE2 inline __m128i set1_epi16<__m128i>(int16_t to) {
 template <> INTGEMM_SSE2 inline __m128i set1_epi32<__m128i>(int32_t to) {
   return _mm_set1_epi32(to);
 }
+template <> INTGEMM_SSE2 inline __m128i set1_epi64<__m128i>(int64_t to) {
+  return _mm_set1_epi64x(to);
+}
 template <> INTGEMM_SSE2 inline __m128d set1_pd<__m128d>(double to) {
   return _mm_set1_pd(to);
 }
@@ -159,18 +169,33 @@ INTGEMM_SSSE3 static inline __m128i sign_epi8(__m128i first, __m128i second) {
 INTGEMM_SSE2 static inline __m128i slli_epi16(__m128i a, int8_t b) {
   return _mm_slli_epi16(a, b);
 }
+INTGEMM_SSE2 static inline __m128i slli_epi64(__m128i a, int8_t b) {
+  return _mm_slli_epi64(a, b);
+}
 INTGEMM_SSE2 static inline __m128i srai_epi16(__m128i a, int8_t b) {
   return _mm_srai_epi16(a, b);
 }
 INTGEMM_SSE2 static inline __m128i srai_epi32(__m128i a, int8_t b) {
   return _mm_srai_epi32(a, b);
 }
+INTGEMM_SSE2 static inline __m128i srl_epi64(__m128i a, __m128i count) {
+  return _mm_srl_epi64(a, count);
+}
 INTGEMM_SSE2 static inline __m128i srli_epi16(__m128i a, int8_t b) {
   return _mm_srli_epi16(a, b);
 }
+INTGEMM_SSE2 static inline __m128i srli_epi64(__m128i a, int8_t b) {
+  return _mm_srli_epi64(a, b);
+}
 INTGEMM_SSE2 static inline void storeu_ps(float* mem_addr, __m128 a) {
   _mm_storeu_ps(mem_addr, a);
 }
+INTGEMM_SSE2 static inline void storeu_si(__m128i* mem_addr, __m128i a) {
+  _mm_storeu_si128(mem_addr, a);
+}
+INTGEMM_SSE2 static inline __m128i sub_epi32(__m128i a, __m128i b) {
+  return _mm_sub_epi32(a, b);
+}
 INTGEMM_SSE2 static inline __m128d sub_pd(__m128d a, __m128d b) {
   return _mm_sub_pd(a, b);
 }
@@ -222,6 +247,9 @@ INTGEMM_AVX2 static inline __m256i add_epi16(__m256i a, __m256i b) {
 INTGEMM_AVX2 static inline __m256i add_epi32(__m256i first, __m256i second) {
   return _mm256_add_epi32(first, second);
 }
+INTGEMM_AVX2 static inline __m256i add_epi64(__m256i a, __m256i b) {
+  return _mm256_add_epi64(a, b);
+}
 INTGEMM_AVX2 static inline __m256i adds_epi16(__m256i first, __m256i second) {
   return _mm256_adds_epi16(first, second);
 }
@@ -304,6 +332,9 @@ INTGEMM_AVX2 static inline __m256i or_si(__m256i a, __m256i b) {
 INTGEMM_AVX2 static inline __m256i packs_epi16(__m256i a, __m256i b) {
   return _mm256_packs_epi16(a, b);
 }
+INTGEMM_AVX2 static inline __m256i packus_epi16(__m256i a, __m256i b) {
+  return _mm256_packus_epi16(a, b);
+}
 INTGEMM_AVX2 static inline __m256i packs_epi32(__m256i a, __m256i b) {
   return _mm256_packs_epi32(a, b);
 }
@@ -316,6 +347,9 @@ template <> INTGEMM_AVX2 inline __m256i set1_epi16<__m256i>(int16_t to) {
 template <> INTGEMM_AVX2 inline __m256i set1_epi32<__m256i>(int32_t to) {
   return _mm256_set1_epi32(to);
 }
+template <> INTGEMM_AVX2 inline __m256i set1_epi64<__m256i>(int64_t to) {
+  return _mm256_set1_epi64x(to);
+}
 template <> INTGEMM_AVX2 inline __m256d set1_pd<__m256d>(double to) {
   return _mm256_set1_pd(to);
 }
@@ -337,18 +371,33 @@ INTGEMM_AVX2 static inline __m256i sign_epi8(__m256i first, __m256i second) {
 INTGEMM_AVX2 static inline __m256i slli_epi16(__m256i a, int8_t b) {
   return _mm256_slli_epi16(a, b);
 }
+INTGEMM_AVX2 static inline __m256i slli_epi64(__m256i a, int8_t b) {
+  return _mm256_slli_epi64(a, b);
+}
 INTGEMM_AVX2 static inline __m256i srai_epi16(__m256i a, int8_t b) {
   return _mm256_srai_epi16(a, b);
 }
 INTGEMM_AVX2 static inline __m256i srai_epi32(__m256i a, int8_t b) {
   return _mm256_srai_epi32(a, b);
 }
+INTGEMM_AVX2 static inline __m256i srl_epi64(__m256i a, __m128i count) {
+  return _mm256_srl_epi64(a, count);
+}
 INTGEMM_AVX2 static inline __m256i srli_epi16(__m256i a, int8_t b) {
   return _mm256_srli_epi16(a, b);
 }
+INTGEMM_AVX2 static inline __m256i srli_epi64(__m256i a, int8_t b) {
+  return _mm256_srli_epi64(a, b);
+}
 INTGEMM_AVX2 static inline void storeu_ps(float* mem_addr, __m256 a) {
   _mm256_storeu_ps(mem_addr, a);
 }
+INTGEMM_AVX2 static inline void storeu_si(__m256i* mem_addr, __m256i a) {
+  _mm256_storeu_si256(mem_addr, a);
+}
+INTGEMM_AVX2 static inline __m256i sub_epi32(__m256i a, __m256i b) {
+  return _mm256_sub_epi32(a, b);
+}
 INTGEMM_AVX2 static inline __m256d sub_pd(__m256d a, __m256d b) {
   return _mm256_sub_pd(a, b);
 }
@@ -402,6 +451,9 @@ INTGEMM_AVX512BW static inline __m512i add_epi16(__m512i a, __m512i b) {
 INTGEMM_AVX512BW static inline __m512i add_epi32(__m512i first, __m512i second) {
   return _mm512_add_epi32(first, second);
 }
+INTGEMM_AVX512BW static inline __m512i add_epi64(__m512i a, __m512i b) {
+  return _mm512_add_epi64(a, b);
+}
 INTGEMM_AVX512BW static inline __m512i adds_epi16(__m512i first, __m512i second) {
   return _mm512_adds_epi16(first, second);
 }
@@ -481,6 +533,9 @@ INTGEMM_AVX512BW static inline __m512i or_si(__m512i a, __m512i b) {
 INTGEMM_AVX512BW static inline __m512i packs_epi16(__m512i a, __m512i b) {
   return _mm512_packs_epi16(a, b);
 }
+INTGEMM_AVX512BW static inline __m512i packus_epi16(__m512i a, __m512i b) {
+  return _mm512_packus_epi16(a, b);
+}
 /* g++ (Ubuntu 5.4.0-6ubuntu1~16.04.12) 5.4.0 20160609 has a bug:
  * /usr/lib/gcc/x86_64-linux-gnu/5/include/avx512bwintrin.h is missing
  * _mm512_packs_epi32 when compiled with debugging.
@@ -507,6 +562,9 @@ template <> inline INTGEMM_AVX512BW __m512i set1_epi16<__m512i>(int16_t to) {
 template <> inline INTGEMM_AVX512BW __m512i set1_epi32<__m512i>(int32_t to) {
   return _mm512_set1_epi32(to);
 }
+template <> inline INTGEMM_AVX512BW __m512i set1_epi64<__m512i>(int64_t to) {
+  return _mm512_set1_epi64(to);
+}
 template <> inline INTGEMM_AVX512BW __m512d set1_pd<__m512d>(double to) {
   return _mm512_set1_pd(to);
 }
@@ -531,18 +589,33 @@ template <> INTGEMM_AVX512BW inline __m512 load_ps<__m512>(const float* from) {
 INTGEMM_AVX512BW static inline __m512i slli_epi16(__m512i a, int8_t b) {
   return _mm512_slli_epi16(a, b);
 }
+INTGEMM_AVX512BW static inline __m512i slli_epi64(__m512i a, int8_t b) {
+  return _mm512_slli_epi64(a, b);
+}
 INTGEMM_AVX512BW static inline __m512i srai_epi16(__m512i a, int8_t b) {
   return _mm512_srai_epi16(a, b);
 }
 INTGEMM_AVX512BW static inline __m512i srai_epi32(__m512i a, int8_t b) {
   return _mm512_srai_epi32(a, b);
 }
+INTGEMM_AVX512BW static inline __m512i srl_epi64(__m512i a, __m128i count) {
+  return _mm512_srl_epi64(a, count);
+}
 INTGEMM_AVX512BW static inline __m512i srli_epi16(__m512i a, int8_t b) {
   return _mm512_srli_epi16(a, b);
 }
+INTGEMM_AVX512BW static inline __m512i srli_epi64(__m512i a, int8_t b) {
+  return _mm512_srli_epi64(a, b);
+}
 INTGEMM_AVX512BW static inline void storeu_ps(float* mem_addr, __m512 a) {
   _mm512_storeu_ps(mem_addr, a);
 }
+INTGEMM_AVX512BW static inline void storeu_si(__m512i* mem_addr, __m512i a) {
+  _mm512_storeu_si512(mem_addr, a);
+}
+INTGEMM_AVX512BW static inline __m512i sub_epi32(__m512i a, __m512i b) {
+  return _mm512_sub_epi32(a, b);
+}
 INTGEMM_AVX512BW static inline __m512d sub_pd(__m512d a, __m512d b) {
   return _mm512_sub_pd(a, b);
 }
@@ -7,6 +7,7 @@
 #include "vec_traits.h"
 
 #include <cstdlib>
+#include <cstring>
 
 #define KERNELS_THIS_IS_SSE2
 #include "kernels/implementations.inl"
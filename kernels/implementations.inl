@@ -88,6 +88,30 @@ CPU_ATTR static inline vd add_bias(vd input, const double* bias_addr, Index bias
   return add_pd(input, bias_term);
 }
 
+/*
+ * Accumulate into the output (read, add and write back)
+ */
+CPU_ATTR static inline void accumulate(vi input, int* output, Index offset) {
+  auto& output_term = *reinterpret_cast<vi*>(output + offset);
+  output_term = add_epi32(input, output_term);
+}
+
+CPU_ATTR static inline void accumulate(vf input, float* output, Index offset) {
+  auto& output_term = *reinterpret_cast<vf*>(output + offset);
+  output_term = add_ps(input, output_term);
+}
+
+CPU_ATTR static inline void accumulate(vd input, double* output, Index offset) {
+  auto& output_term = *reinterpret_cast<vd*>(output + offset);
+  output_term = add_pd(input, output_term);
+}
+
+/* output = input + beta * output */
+CPU_ATTR static inline void accumulate(vf input, float* output, vf beta, Index offset) {
+  auto& output_term = *reinterpret_cast<vf*>(output + offset);
+  output_term = add_ps(input, mul_ps(beta, output_term));
+}
+
 /*
  * ReLU
  */
@@ -193,6 +217,20 @@ CPU_ATTR static inline vi downcast32to8(vi input1, vi input2, vi input3, vi inpu
 #endif
 }
 
+// Same as downcast32to8 but saturating to [0, 255].
+CPU_ATTR static inline vi downcast32to8u(vi input1, vi input2, vi input3, vi input4) {
+  auto result = packus_epi16(packs_epi32(input1, input2), packs_epi32(input3, input4));
+
+#if defined(KERNELS_THIS_IS_SSE2)
+  return result;
+#elif defined(KERNELS_THIS_IS_AVX2)
+  return _mm256_shuffle_epi32(_mm256_permute4x64_epi64(result, 0xd8 /* = 0 2 1 3 */), 0xd8 /* = 0 2 1 3 */);
+#else
+  static const auto permutation_indices = _mm512_set_epi32(15, 11, 7, 3, 14, 10, 6, 2, 13, 9, 5, 1, 12, 8, 4, 0);
+  return _mm512_castps_si512(_mm512_permutexvar_ps(permutation_indices, _mm512_castsi512_ps(result)));
+#endif
+}
+
 CPU_ATTR static inline vi downcast32to16(vi input1, vi input2) {
   auto result = packs_epi32(input1, input2);
 
@@ -288,6 +326,46 @@ CPU_ATTR static inline vi rescale(vi input, vf scale) {
   return cvtps_epi32(mul_ps(cvtepi32_ps(input), scale));
 }
 
+/*
+ * Saturate 64-bit lanes below 2^62 to [0, 2^31 - 1], leaving the upper half of
+ * each lane zero.  A lane overflows iff lane >> 31 is nonzero; that fits in 31
+ * bits, so negating it as int32 sets the sign bit exactly on overflow.
+ */
+CPU_ATTR static inline vi saturate_epu64_to_31(vi lanes) {
+  auto overflow = srai_epi32(sub_epi32(setzero_si<vi>(), srli_epi64(lanes, 31)), 31);
+  return and_si(or_si(lanes, overflow), set1_epi64<vi>(0x7fffffff));
+}
+
+/*
+ * Fixed-point requantization of int32 (integer-only, so bit-exact on every
+ * architecture): round(input * multiplier / 2^right_shift) with ties rounded
+ * away from zero, saturated to [-(2^31 - 1), 2^31 - 1].  multiplier must be in
+ * [0, 2^31), rounding holds 2^(right_shift - 1) in every 64-bit lane and
+ * right_shift is in [1, 62].
+ */
+CPU_ATTR static inline vi requantize(vi input, vi multiplier, vi rounding, __m128i right_shift) {
+  // Work on magnitudes so the unsigned 32 x 32 -> 64-bit multiply applies.
+  auto sign = srai_epi32(input, 31);
+  auto magnitude = sub_epi32(xor_si(input, sign), sign);
+  auto even = mul_epu32(magnitude, multiplier);
+  auto odd = mul_epu32(srli_epi64(magnitude, 32), multiplier);
+  // With scale >= 1 (right_shift <= 31) the results can exceed int32.
+  even = saturate_epu64_to_31(srl_epi64(add_epi64(even, rounding), right_shift));
+  odd = saturate_epu64_to_31(srl_epi64(add_epi64(odd, rounding), right_shift));
+  auto result = or_si(even, slli_epi64(odd, 32));
+  return sub_epi32(xor_si(result, sign), sign);
+}
+
+/*
+ * Saturate int32 to [-127, 127], the range Multiply accepts for A, and write
+ * one byte per input element.
+ */
+CPU_ATTR static inline void write_saturated(vi input, int8_t* output, Index offset) {
+  auto halves = max_epi16(downcast32to16(input, input), set1_epi16<vi>(-127));
+  auto bytes = downcast16to8(halves, halves);
+  std::memcpy(output + offset, &bytes, sizeof(vi) / sizeof(int));
+}
+
 /*
  * Bitwise not
  */
@@ -5,7 +5,9 @@
 #include "intrinsics.h"
 #include "vec_traits.h"
 #include "callbacks.h"
+#include "aligned.h"
 
+#include <algorithm>
 #include <cmath> //sqrt
 
 namespace intgemm {
@@ -26,6 +28,31 @@ INTGEMM_SSE2 static inline float MaxFloat32(__m128 a) {
   return *reinterpret_cast<float*>(&a);
 }
 
+/* Reduce four registers at once: lane i of the result is the sum (or maximum)
+ * of register i.  Used by the row statistics to pay for one horizontal
+ * reduction per four rows.
+ */
+INTGEMM_SSE2 static inline __m128 HorizontalSum4(__m128 a, __m128 b, __m128 c, __m128 d) {
+  // a0+a2 b0+b2 a1+a3 b1+b3
+  __m128 ab = _mm_add_ps(_mm_unpacklo_ps(a, b), _mm_unpackhi_ps(a, b));
+  __m128 cd = _mm_add_ps(_mm_unpacklo_ps(c, d), _mm_unpackhi_ps(c, d));
+  return _mm_add_ps(_mm_movelh_ps(ab, cd), _mm_movehl_ps(cd, ab));
+}
+
+INTGEMM_SSE2 static inline __m128 HorizontalMax4(__m128 a, __m128 b, __m128 c, __m128 d) {
+  __m128 ab = _mm_max_ps(_mm_unpacklo_ps(a, b), _mm_unpackhi_ps(a, b));
+  __m128 cd = _mm_max_ps(_mm_unpacklo_ps(c, d), _mm_unpackhi_ps(c, d));
+  return _mm_max_ps(_mm_movelh_ps(ab, cd), _mm_movehl_ps(cd, ab));
+}
+
+/* Unnormalized Walsh-Hadamard transform of the lanes of a register: each
+ * stage h replaces lane p by x[p ^ h] + x[p], or x[p ^ h] - x[p] where bit h
+ * of p is set. */
+INTGEMM_SSE2 static inline __m128 HadamardInRegister(__m128 x) {
+  x = _mm_add_ps(_mm_shuffle_ps(x, x, 0xB1), _mm_xor_ps(x, _mm_set_ps(-0.f, 0.f, -0.f, 0.f)));
+  return _mm_add_ps(_mm_shuffle_ps(x, x, 0x4E), _mm_xor_ps(x, _mm_set_ps(-0.f, -0.f, 0.f, 0.f)));
+}
+
 INTGEMM_SSE2 static inline dvector_t<CPUType::SSE2, int> PermuteSummer(__m128i pack0123, __m128i pack4567) {
   // No op for 128 bits: already reduced fully.
   return { pack0123, pack4567 };
@@ -59,6 +86,28 @@ INTGEMM_AVX2 static inline float horizontalSum(__m256 a) {
     return horizontalSum(vlow);         // and inline the sse3 version, which is optimal for AVX
 }
 
+INTGEMM_AVX2 static inline __m128 HorizontalSum4(__m256 a, __m256 b, __m256 c, __m256 d) {
+  return HorizontalSum4(
+      _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)),
+      _mm_add_ps(_mm256_castps256_ps128(b), _mm256_extractf128_ps(b, 1)),
+      _mm_add_ps(_mm256_castps256_ps128(c), _mm256_extractf128_ps(c, 1)),
+      _mm_add_ps(_mm256_castps256_ps128(d), _mm256_extractf128_ps(d, 1)));
+}
+
+INTGEMM_AVX2 static inline __m128 HorizontalMax4(__m256 a, __m256 b, __m256 c, __m256 d) {
+  return HorizontalMax4(
+      _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)),
+      _mm_max_ps(_mm256_castps256_ps128(b), _mm256_extractf128_ps(b, 1)),
+      _mm_max_ps(_mm256_castps256_ps128(c), _mm256_extractf128_ps(c, 1)),
+      _mm_max_ps(_mm256_castps256_ps128(d), _mm256_extractf128_ps(d, 1)));
+}
+
+INTGEMM_AVX2 static inline __m256 HadamardInRegister(__m256 x) {
+  x = _mm256_add_ps(_mm256_permute_ps(x, 0xB1), _mm256_xor_ps(x, _mm256_set_ps(-0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f)));
+  x = _mm256_add_ps(_mm256_permute_ps(x, 0x4E), _mm256_xor_ps(x, _mm256_set_ps(-0.f, -0.f, 0.f, 0.f, -0.f, -0.f, 0.f, 0.f)));
+  return _mm256_add_ps(_mm256_permute2f128_ps(x, x, 1), _mm256_xor_ps(x, _mm256_set_ps(-0.f, -0.f, -0.f, -0.f, 0.f, 0.f, 0.f, 0.f)));
+}
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
 /* Only INTGEMM_AVX512F is necessary but due to GCC 5.4 bug we have to set INTGEMM_AVX512BW */
 INTGEMM_AVX512BW static inline __m256i PermuteSummer(__m512i pack0123, __m512i pack4567) {
@@ -72,6 +121,18 @@ INTGEMM_AVX512BW static inline __m256i PermuteSummer(__m512i pack0123, __m512i p
   return _mm256_add_epi32(_mm512_castsi512_si256(added), _mm512_extracti64x4_epi64(added, 1));
 }
 
+/* Same for 16 columns: each pack holds 4 columns summed to 128 bits, repeated
+ * across the 4 lanes.  Returns 0 1 2 ... 15 in one register, which is what
+ * the AVX512BW callbacks consume.
+ */
+INTGEMM_AVX512BW static inline __m512i PermuteSummer(__m512i pack0123, __m512i pack4567, __m512i pack89ab, __m512i packcdef) {
+  // [0123 lane 0, 0123 lane 1, 4567 lane 0, 4567 lane 1] + [0123 lane 2, 0123 lane 3, 4567 lane 2, 4567 lane 3]
+  __m512i mix0 = _mm512_add_epi32(_mm512_shuffle_i32x4(pack0123, pack4567, 0x44), _mm512_shuffle_i32x4(pack0123, pack4567, 0xee));
+  __m512i mix1 = _mm512_add_epi32(_mm512_shuffle_i32x4(pack89ab, packcdef, 0x44), _mm512_shuffle_i32x4(pack89ab, packcdef, 0xee));
+  // Now each pack is reduced to two lanes.  Gather the even and odd lanes and add them.
+  return _mm512_add_epi32(_mm512_shuffle_i32x4(mix0, mix1, 0x88), _mm512_shuffle_i32x4(mix0, mix1, 0xdd));
+}
+
 // Find the maximum float.
 static inline INTGEMM_AVX512F float MaxFloat32(__m512 a) {
   // _mm512_extractf32x8_ps is AVX512DQ but we don't care about masking.
@@ -86,6 +147,35 @@ static inline INTGEMM_AVX512F float horizontalSum(__m512 a) {
   return horizontalSum(low) + horizontalSum(high);
 }
 
+// Fold 512 bits to 256 without AVX512DQ, as in MaxFloat32.
+static inline INTGEMM_AVX512F __m256 UpperHalf(__m512 a) {
+  return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 1));
+}
+
+static inline INTGEMM_AVX512F __m128 HorizontalSum4(__m512 a, __m512 b, __m512 c, __m512 d) {
+  return HorizontalSum4(
+      _mm256_add_ps(_mm512_castps512_ps256(a), UpperHalf(a)),
+      _mm256_add_ps(_mm512_castps512_ps256(b), UpperHalf(b)),
+      _mm256_add_ps(_mm512_castps512_ps256(c), UpperHalf(c)),
+      _mm256_add_ps(_mm512_castps512_ps256(d), UpperHalf(d)));
+}
+
+static inline INTGEMM_AVX512F __m128 HorizontalMax4(__m512 a, __m512 b, __m512 c, __m512 d) {
+  return HorizontalMax4(
+      _mm256_max_ps(_mm512_castps512_ps256(a), UpperHalf(a)),
+      _mm256_max_ps(_mm512_castps512_ps256(b), UpperHalf(b)),
+      _mm256_max_ps(_mm512_castps512_ps256(c), UpperHalf(c)),
+      _mm256_max_ps(_mm512_castps512_ps256(d), UpperHalf(d)));
+}
+
+// With FMA each stage is a shuffle and x * sign + shuffled, sign being -1 where bit h is set.
+static inline INTGEMM_AVX512F __m512 HadamardInRegister(__m512 x) {
+  x = _mm512_fmadd_ps(x, _mm512_set_ps(-1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1), _mm512_permute_ps(x, 0xB1));
+  x = _mm512_fmadd_ps(x, _mm512_set_ps(-1, -1, 1, 1, -1, -1, 1, 1, -1, -1, 1, 1, -1, -1, 1, 1), _mm512_permute_ps(x, 0x4E));
+  x = _mm512_fmadd_ps(x, _mm512_set_ps(-1, -1, -1, -1, 1, 1, 1, 1, -1, -1, -1, -1, 1, 1, 1, 1), _mm512_shuffle_f32x4(x, x, 0xB1));
+  return _mm512_fmadd_ps(x, _mm512_set_ps(-1, -1, -1, -1, -1, -1, -1, -1, 1, 1, 1, 1, 1, 1, 1, 1), _mm512_shuffle_f32x4(x, x, 0x4E));
+}
+
 #endif
 
 // Quantize function used for SSSE3 and AVX2.
@@ -160,6 +250,33 @@ INTGEMM_AVX2 static inline void RunCallback(Callback& callback_impl, vector_t<CP
   callback_impl(total, callbacks::OutputBufferInfo(row_idx, col_idx, rows, cols));
 }
 
+// Float results of MultiplyGrouped.
+template <typename Callback>
+INTGEMM_SSE2 static inline void RunCallback(Callback& callback_impl, dvector_t<CPUType::SSE2, float> total, Index row_idx, Index col_idx, Index rows, Index cols) {
+  callback_impl(total.first, callbacks::OutputBufferInfo(row_idx, col_idx, rows, cols));
+  callback_impl(total.second, callbacks::OutputBufferInfo(row_idx, col_idx + 4, rows, cols));
+}
+
+template <typename Callback>
+INTGEMM_AVX2 static inline void RunCallback(Callback& callback_impl, vector_t<CPUType::AVX2, float> total, Index row_idx, Index col_idx, Index rows, Index cols) {
+  callback_impl(total, callbacks::OutputBufferInfo(row_idx, col_idx, rows, cols));
+}
+
+/* MultiplyGrouped: accumulate += float(total) * scales[0..7] * a_scale, where
+ * total holds one group's 32-bit sums for 8 consecutive columns. */
+INTGEMM_SSE2 static inline void ScaleAndAccumulate(dvector_t<CPUType::SSE2, int> total, const float *scales, __m128 a_scale, dvector_t<CPUType::SSE2, float> &accumulate) {
+  accumulate.first = add_ps(accumulate.first, mul_ps(mul_ps(cvtepi32_ps(total.first), loadu_ps<__m128>(scales)), a_scale));
+  accumulate.second = add_ps(accumulate.second, mul_ps(mul_ps(cvtepi32_ps(total.second), loadu_ps<__m128>(scales + 4)), a_scale));
+}
+
+INTGEMM_AVX2 static inline void ScaleAndAccumulate(__m256i total, const float *scales, __m256 a_scale, __m256 &accumulate) {
+  accumulate = add_ps(accumulate, mul_ps(mul_ps(cvtepi32_ps(total), loadu_ps<__m256>(scales)), a_scale));
+}
+
+// Float accumulator for 8 columns: two registers on SSE2, one on AVX2.
+template <CPUType cpu_type> struct GroupedAccumulator { typedef vector_t<cpu_type, float> Type; };
+template <> struct GroupedAccumulator<CPUType::SSE2> { typedef dvector_t<CPUType::SSE2, float> Type; };
+
 // 16-bit multiplier for INTGEMM_SSE2, INTGEMM_AVX2, and AVX512.
 // C = A * B * unquant_mult
 //
@@ -643,6 +760,68 @@ INTGEMM_SSSE3 inline static void InnerINTGEMM_SSSE3(
   } \
 }
 
+/* Group-wise version of INTGEMM_MULTIPLY8.  The shared dimension is cut into
+ * groups of group_size; each group's 16-bit sums are widened to 32 bits,
+ * converted to float and scaled by B_scales[group * B_cols + column] and
+ * A_scales[row * (width / group_size) + group] (1 if A_scales is nullptr)
+ * before being added up in float.  The callback receives floats.
+ */
+#define INTGEMM_MULTIPLY8GROUPED(Register, target, cpu_type) \
+  template <typename Callback> target static void MultiplyGrouped(const int8_t *A, const int8_t *B, const float *A_scales, const float *B_scales, Index group_size, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  assert(group_size % sizeof(Register) == 0); \
+  assert(width % group_size == 0); \
+  assert(B_cols % 8 == 0); \
+  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
+  typedef typename GroupedAccumulator<cpu_type>::Type Floats; \
+  typedef vector_t<cpu_type, float> FloatRegister; \
+  const int simd_width = width / sizeof(Register); \
+  const int simd_group = group_size / sizeof(Register); \
+  const Index groups = width / group_size; \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  _Pragma("omp for") \
+  for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) { \
+    const Register *B0_col = reinterpret_cast<const Register *>(B) + simd_width * B0_colidx; \
+    for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) { \
+      const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width); \
+      const Register *B_live = B0_col; \
+      Floats accumulate = Floats(); \
+      for (Index group = 0; group < groups; ++group) { \
+        const Register *A_end = A_live + simd_group; \
+        Register a = *(A_live++); \
+        Register a_positive = abs_epi8(a); \
+        Register sum0 = maddubs_epi16(a_positive, sign_epi8(B_live[0], a)); \
+        Register sum1 = maddubs_epi16(a_positive, sign_epi8(B_live[1], a)); \
+        Register sum2 = maddubs_epi16(a_positive, sign_epi8(B_live[2], a)); \
+        Register sum3 = maddubs_epi16(a_positive, sign_epi8(B_live[3], a)); \
+        Register sum4 = maddubs_epi16(a_positive, sign_epi8(B_live[4], a)); \
+        Register sum5 = maddubs_epi16(a_positive, sign_epi8(B_live[5], a)); \
+        Register sum6 = maddubs_epi16(a_positive, sign_epi8(B_live[6], a)); \
+        Register sum7 = maddubs_epi16(a_positive, sign_epi8(B_live[7], a)); \
+        B_live += 8; \
+        for (; A_live != A_end; ++A_live, B_live += 8) { \
+          Inner##target(*A_live, B_live, sum0, sum1, sum2, sum3, sum4, sum5, sum6, sum7); \
+        } \
+        Register ones = set1_epi16<Register>(1); \
+        sum0 = madd_epi16(sum0, ones); \
+        sum1 = madd_epi16(sum1, ones); \
+        sum2 = madd_epi16(sum2, ones); \
+        sum3 = madd_epi16(sum3, ones); \
+        sum4 = madd_epi16(sum4, ones); \
+        sum5 = madd_epi16(sum5, ones); \
+        sum6 = madd_epi16(sum6, ones); \
+        sum7 = madd_epi16(sum7, ones); \
+        Register pack0123 = Pack0123(sum0, sum1, sum2, sum3); \
+        Register pack4567 = Pack0123(sum4, sum5, sum6, sum7); \
+        auto total = PermuteSummer(pack0123, pack4567); \
+        FloatRegister a_scale = set1_ps<FloatRegister>(A_scales ? A_scales[A_rowidx * groups + group] : 1.0f); \
+        ScaleAndAccumulate(total, B_scales + group * B_cols + B0_colidx, a_scale, accumulate); \
+      } \
+      RunCallback(callback_impl, accumulate, A_rowidx, B0_colidx, A_rows, B_cols); \
+    } \
+  } \
+}
+
 /* Wrap a multiply call in OMP parallelism.  Here it launches threads then
  * inside the implementation there is a pragma omp for.  In gcc >= 8 these
  * could have been the same but older compilers don't imbue target attributes
@@ -660,6 +839,10 @@ template <class Callback, class Backend> static inline void OMPParallelWrap8Shif
 #pragma omp parallel
   Backend::template Multiply8Shift<Callback>(A, B, A_rows, width, B_cols, callback);
 }
+template <class Callback, class Backend> static inline void OMPParallelWrapGrouped(const int8_t *A, const int8_t *B, const float *A_scales, const float *B_scales, Index group_size, Index A_rows, Index width, Index B_cols, Callback callback) {
+#pragma omp parallel
+  Backend::template MultiplyGrouped<Callback>(A, B, A_scales, B_scales, group_size, A_rows, width, B_cols, callback);
+}
 
 #define INTGEMM_MAXABSOLUTE(Register, target) \
 target static inline float MaxAbsolute(const float *begin_float, const float *end_float) { \
@@ -671,12 +854,21 @@ target static inline float MaxAbsolute(const float *begin_float, const float *en
   union {float f; int32_t i;} and_convert, float_convert; \
   and_convert.i = 0x7fffffff; \
   Register and_me = set1_ps<Register>(and_convert.f); \
-  Register highest = setzero_ps<Register>(); \
+  /* Four independent accumulators hide the latency of max_ps. */ \
+  Register highest0 = setzero_ps<Register>(); \
+  Register highest1 = setzero_ps<Register>(); \
+  Register highest2 = setzero_ps<Register>(); \
+  Register highest3 = setzero_ps<Register>(); \
+  for (; end - begin >= 4; begin += 4) { \
+    highest0 = max_ps(highest0, and_ps(and_me, begin[0])); \
+    highest1 = max_ps(highest1, and_ps(and_me, begin[1])); \
+    highest2 = max_ps(highest2, and_ps(and_me, begin[2])); \
+    highest3 = max_ps(highest3, and_ps(and_me, begin[3])); \
+  } \
   for (; begin < end; ++begin) { \
-    Register reg = and_ps(and_me, *begin); \
-    highest = max_ps(highest, reg); \
+    highest0 = max_ps(highest0, and_ps(and_me, *begin)); \
   } \
-  float ret = MaxFloat32(highest); \
+  float ret = MaxFloat32(max_ps(max_ps(highest0, highest1), max_ps(highest2, highest3))); \
   /* Overhang: this would be more efficient if done in a single SIMD operation with some zeroing */ \
   for (const float *i = end_reg; i < end_float; ++i) { \
     float_convert.f = *i; \
@@ -686,36 +878,495 @@ target static inline float MaxAbsolute(const float *begin_float, const float *en
   return ret; \
 } \
 
+// Floats per block of VectorMeanStd.  A block stays in L1 between its two passes.
+static const std::size_t kMeanStdBlock = 4096;
+
+/* Merge the statistics of a block of block_count values into running ones
+ * (Chan, Golub and LeVeque).  m2 is the sum of squared deviations from the mean.
+ */
+static inline void CombineMeanStd(double &count, double &mean, double &m2, double block_count, double block_mean, double block_m2) {
+  double total = count + block_count;
+  double delta = block_mean - mean;
+  mean += delta * block_count / total;
+  m2 += block_m2 + delta * delta * count * block_count / total;
+  count = total;
+}
+
 #define INTGEMM_VECTORMEANSTD(Register, target) \
-target static inline MeanStd VectorMeanStd(const float *begin_float, const float *end_float, bool absolute) { \
-  /* Computes the euclidean norm and returns the mean and the standard deviation. Optionally it can be the mean and standard deviation in absolute terms. */ \
+/* Merge the values of [begin_float, end_float), or their absolute values, into \
+ * the running count, mean and m2 a block at a time with CombineMeanStd. */ \
+target static inline void VectorMoments(const float *begin_float, const float *end_float, bool absolute, double &count, double &mean, double &m2) { \
+  /* Each block is summed, then its squared deviations from its own mean are summed, \
+   * avoiding the cancellation of E[x^2] - E[x]^2 when the mean is large. */ \
   assert(end_float > begin_float); \
   assert((end_float - begin_float) % (sizeof(Register) / sizeof(float)) == 0); \
-  size_t num_items = end_float - begin_float; \
+  /* andnot with -0 clears the sign; with +0 it does nothing. */ \
+  const Register mask = set1_ps<Register>(absolute ? -0.f : 0.f); \
+  for (const float *block = begin_float; block != end_float; ) { \
+    const float *block_end = block + std::min<std::size_t>(kMeanStdBlock, end_float - block); \
+    const Register *begin = reinterpret_cast<const Register*>(block); \
+    const Register *end = reinterpret_cast<const Register*>(block_end); \
+    const Register *it; \
+    /* Four independent accumulators per pass hide the latency of add_ps. */ \
+    Register sums0 = setzero_ps<Register>(), sums1 = setzero_ps<Register>(); \
+    Register sums2 = setzero_ps<Register>(), sums3 = setzero_ps<Register>(); \
+    for (it = begin; end - it >= 4; it += 4) { \
+      sums0 = add_ps(sums0, andnot_ps(mask, it[0])); \
+      sums1 = add_ps(sums1, andnot_ps(mask, it[1])); \
+      sums2 = add_ps(sums2, andnot_ps(mask, it[2])); \
+      sums3 = add_ps(sums3, andnot_ps(mask, it[3])); \
+    } \
+    for (; it != end; ++it) sums0 = add_ps(sums0, andnot_ps(mask, *it)); \
+    float block_count = static_cast<float>(block_end - block); \
+    float block_mean = horizontalSum(add_ps(add_ps(sums0, sums1), add_ps(sums2, sums3))) / block_count; \
+    const Register mean_reg = set1_ps<Register>(block_mean); \
+    /* Reuse sums* to accumulate the squared deviations. */ \
+    sums0 = sums1 = sums2 = sums3 = setzero_ps<Register>(); \
+    for (it = begin; end - it >= 4; it += 4) { \
+      Register d0 = sub_ps(andnot_ps(mask, it[0]), mean_reg); \
+      Register d1 = sub_ps(andnot_ps(mask, it[1]), mean_reg); \
+      Register d2 = sub_ps(andnot_ps(mask, it[2]), mean_reg); \
+      Register d3 = sub_ps(andnot_ps(mask, it[3]), mean_reg); \
+      sums0 = add_ps(sums0, mul_ps(d0, d0)); \
+      sums1 = add_ps(sums1, mul_ps(d1, d1)); \
+      sums2 = add_ps(sums2, mul_ps(d2, d2)); \
+      sums3 = add_ps(sums3, mul_ps(d3, d3)); \
+    } \
+    for (; it != end; ++it) { \
+      Register d0 = sub_ps(andnot_ps(mask, *it), mean_reg); \
+      sums0 = add_ps(sums0, mul_ps(d0, d0)); \
+    } \
+    float block_m2 = horizontalSum(add_ps(add_ps(sums0, sums1), add_ps(sums2, sums3))); \
+    CombineMeanStd(count, mean, m2, block_count, block_mean, block_m2); \
+    block = block_end; \
+  } \
+} \
+\
+target static inline MeanStd VectorMeanStd(const float *begin_float, const float *end_float, bool absolute) { \
+  /* Computes the mean and the standard deviation. Optionally it can be the mean and standard deviation in absolute terms. */ \
+  double count = 0, mean = 0, m2 = 0; \
+  VectorMoments(begin_float, end_float, absolute, count, mean, m2); \
+  MeanStd ret; \
+  ret.mean = static_cast<float>(mean); \
+  ret.stddev = static_cast<float>(std::sqrt(m2 / count)); \
+  return ret; \
+} \
+
+/* Statistics of each row of a rows x cols matrix whose rows start stride
+ * floats apart.  Four rows go through the loop together so one HorizontalMax4
+ * or HorizontalSum4 finishes all four; the last group repeats the last row.
+ * Rows need not be aligned.  Columns past the last full register are scalar.
+ * ColumnMaxAbsolute is the odd one out: one maximum per column.
+ */
+#define INTGEMM_ROW_POINTERS(row, input, r, rows, stride) \
+  const float *row[4]; \
+  for (Index i = 0; i < 4; ++i) row[i] = input + std::min(r + i, rows - 1) * stride; \
+
+#define INTGEMM_ROWSTATISTICS(Register, target) \
+/* Blocks of 4 registers of columns down a band of rows at a time: the maxima \
+ * stay in registers within a band and the band's rows stay in cache. */ \
+target static inline void ColumnMaxAbsolute(const float *input, Index rows, Index cols, Index stride, float *output) { \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index kBand = 16; \
+  const Index simd_cols = cols - cols % kLanes; \
+  const Register sign = set1_ps<Register>(-0.f); \
+  std::fill(output, output + cols, 0.f); \
+  for (Index r = 0; r < rows; r += kBand) { \
+    const float *band_begin = input + r * stride; \
+    const float *band_end = input + std::min(r + kBand, rows) * stride; \
+    Index c = 0; \
+    for (; c + 4 * kLanes <= simd_cols; c += 4 * kLanes) { \
+      Register max0 = loadu_ps<Register>(output + c), max1 = loadu_ps<Register>(output + c + kLanes); \
+      Register max2 = loadu_ps<Register>(output + c + 2 * kLanes), max3 = loadu_ps<Register>(output + c + 3 * kLanes); \
+      for (const float *row = band_begin + c; row < band_end; row += stride) { \
+        max0 = max_ps(max0, andnot_ps(sign, loadu_ps<Register>(row))); \
+        max1 = max_ps(max1, andnot_ps(sign, loadu_ps<Register>(row + kLanes))); \
+        max2 = max_ps(max2, andnot_ps(sign, loadu_ps<Register>(row + 2 * kLanes))); \
+        max3 = max_ps(max3, andnot_ps(sign, loadu_ps<Register>(row + 3 * kLanes))); \
+      } \
+      storeu_ps(output + c, max0); \
+      storeu_ps(output + c + kLanes, max1); \
+      storeu_ps(output + c + 2 * kLanes, max2); \
+      storeu_ps(output + c + 3 * kLanes, max3); \
+    } \
+    for (; c < simd_cols; c += kLanes) { \
+      Register max0 = loadu_ps<Register>(output + c); \
+      for (const float *row = band_begin + c; row < band_end; row += stride) { \
+        max0 = max_ps(max0, andnot_ps(sign, loadu_ps<Register>(row))); \
+      } \
+      storeu_ps(output + c, max0); \
+    } \
+    for (; c < cols; ++c) { \
+      for (const float *row = band_begin + c; row < band_end; row += stride) output[c] = std::max(output[c], std::fabs(*row)); \
+    } \
+  } \
+} \
+\
+target static inline void RowMaxAbsolute(const float *input, Index rows, Index cols, Index stride, float *output) { \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index simd_cols = cols - cols % kLanes; \
+  const Register sign = set1_ps<Register>(-0.f); \
+  for (Index r = 0; r < rows; r += 4) { \
+    INTGEMM_ROW_POINTERS(row, input, r, rows, stride) \
+    Register max0 = setzero_ps<Register>(), max1 = setzero_ps<Register>(); \
+    Register max2 = setzero_ps<Register>(), max3 = setzero_ps<Register>(); \
+    for (Index c = 0; c < simd_cols; c += kLanes) { \
+      max0 = max_ps(max0, andnot_ps(sign, loadu_ps<Register>(row[0] + c))); \
+      max1 = max_ps(max1, andnot_ps(sign, loadu_ps<Register>(row[1] + c))); \
+      max2 = max_ps(max2, andnot_ps(sign, loadu_ps<Register>(row[2] + c))); \
+      max3 = max_ps(max3, andnot_ps(sign, loadu_ps<Register>(row[3] + c))); \
+    } \
+    float result[4]; \
+    storeu_ps(result, HorizontalMax4(max0, max1, max2, max3)); \
+    for (Index i = 0; i < 4 && r + i < rows; ++i) { \
+      for (Index c = simd_cols; c < cols; ++c) result[i] = std::max(result[i], std::fabs(row[i][c])); \
+      output[r + i] = result[i]; \
+    } \
+  } \
+} \
+\
+target static inline void RowSum(const float *input, Index rows, Index cols, Index stride, float *output) { \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index simd_cols = cols - cols % kLanes; \
+  for (Index r = 0; r < rows; r += 4) { \
+    INTGEMM_ROW_POINTERS(row, input, r, rows, stride) \
+    Register sum0 = setzero_ps<Register>(), sum1 = setzero_ps<Register>(); \
+    Register sum2 = setzero_ps<Register>(), sum3 = setzero_ps<Register>(); \
+    for (Index c = 0; c < simd_cols; c += kLanes) { \
+      sum0 = add_ps(sum0, loadu_ps<Register>(row[0] + c)); \
+      sum1 = add_ps(sum1, loadu_ps<Register>(row[1] + c)); \
+      sum2 = add_ps(sum2, loadu_ps<Register>(row[2] + c)); \
+      sum3 = add_ps(sum3, loadu_ps<Register>(row[3] + c)); \
+    } \
+    float result[4]; \
+    storeu_ps(result, HorizontalSum4(sum0, sum1, sum2, sum3)); \
+    for (Index i = 0; i < 4 && r + i < rows; ++i) { \
+      for (Index c = simd_cols; c < cols; ++c) result[i] += row[i][c]; \
+      output[r + i] = result[i]; \
+    } \
+  } \
+} \
+\
+/* Two passes per group of rows, the second over squared deviations from the \
+ * row's mean, so a large mean does not cancel.  The rows are usually still in \
+ * cache for the second pass. */ \
+target static inline void RowMeanStd(const float *input, Index rows, Index cols, Index stride, bool absolute, MeanStd *output) { \
+  assert(cols > 0); \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index simd_cols = cols - cols % kLanes; \
+  /* andnot with -0 clears the sign; with +0 it does nothing. */ \
+  const Register mask = set1_ps<Register>(absolute ? -0.f : 0.f); \
+  for (Index r = 0; r < rows; r += 4) { \
+    INTGEMM_ROW_POINTERS(row, input, r, rows, stride) \
+    Register sum0 = setzero_ps<Register>(), sum1 = setzero_ps<Register>(); \
+    Register sum2 = setzero_ps<Register>(), sum3 = setzero_ps<Register>(); \
+    for (Index c = 0; c < simd_cols; c += kLanes) { \
+      sum0 = add_ps(sum0, andnot_ps(mask, loadu_ps<Register>(row[0] + c))); \
+      sum1 = add_ps(sum1, andnot_ps(mask, loadu_ps<Register>(row[1] + c))); \
+      sum2 = add_ps(sum2, andnot_ps(mask, loadu_ps<Register>(row[2] + c))); \
+      sum3 = add_ps(sum3, andnot_ps(mask, loadu_ps<Register>(row[3] + c))); \
+    } \
+    float mean[4]; \
+    storeu_ps(mean, HorizontalSum4(sum0, sum1, sum2, sum3)); \
+    for (Index i = 0; i < 4; ++i) { \
+      for (Index c = simd_cols; c < cols; ++c) mean[i] += absolute ? std::fabs(row[i][c]) : row[i][c]; \
+      mean[i] /= static_cast<float>(cols); \
+    } \
+    const Register mean0 = set1_ps<Register>(mean[0]), mean1 = set1_ps<Register>(mean[1]); \
+    const Register mean2 = set1_ps<Register>(mean[2]), mean3 = set1_ps<Register>(mean[3]); \
+    sum0 = sum1 = sum2 = sum3 = setzero_ps<Register>(); \
+    for (Index c = 0; c < simd_cols; c += kLanes) { \
+      Register d0 = sub_ps(andnot_ps(mask, loadu_ps<Register>(row[0] + c)), mean0); \
+      Register d1 = sub_ps(andnot_ps(mask, loadu_ps<Register>(row[1] + c)), mean1); \
+      Register d2 = sub_ps(andnot_ps(mask, loadu_ps<Register>(row[2] + c)), mean2); \
+      Register d3 = sub_ps(andnot_ps(mask, loadu_ps<Register>(row[3] + c)), mean3); \
+      sum0 = add_ps(sum0, mul_ps(d0, d0)); \
+      sum1 = add_ps(sum1, mul_ps(d1, d1)); \
+      sum2 = add_ps(sum2, mul_ps(d2, d2)); \
+      sum3 = add_ps(sum3, mul_ps(d3, d3)); \
+    } \
+    float squares[4]; \
+    storeu_ps(squares, HorizontalSum4(sum0, sum1, sum2, sum3)); \
+    for (Index i = 0; i < 4 && r + i < rows; ++i) { \
+      for (Index c = simd_cols; c < cols; ++c) { \
+        float d = (absolute ? std::fabs(row[i][c]) : row[i][c]) - mean[i]; \
+        squares[i] += d * d; \
+      } \
+      output[r + i].mean = mean[i]; \
+      output[r + i].stddev = std::sqrt(squares[i] / static_cast<float>(cols)); \
+    } \
+  } \
+} \
+
+/* Histogram of absolute values: adds one to counts[min(|x| * bins_per_unit, bins - 1)]
+ * for every x.  Values past the last bin (including infinity and NaN) land in it.
+ * Only the bin index is vectorized; the increments are scalar.
+ */
+#define INTGEMM_ABSOLUTEHISTOGRAM(Register, target) \
+target static inline void AbsoluteHistogram(const float *begin_float, const float *end_float, float bins_per_unit, Index bins, uint64_t *counts) { \
+  assert(reinterpret_cast<uintptr_t>(begin_float) % sizeof(Register) == 0); \
   const Register *begin = reinterpret_cast<const Register*>(begin_float); \
-  const Register *end = reinterpret_cast<const Register*>(end_float); \
-  Register squares = set1_ps<Register>(0); \
-  Register sums = set1_ps<Register>(0); \
-  if (absolute) { \
-    const Register mask = set1_ps<Register>(-0.f); \
-    for (; begin != end; begin++) { \
-      Register vec = *begin; \
-      vec = andnot_ps(mask, vec); \
-      squares = add_ps(squares, mul_ps(vec, vec)); \
-      sums = add_ps(sums, vec); \
+  const float *end_reg = end_float - (end_float - begin_float) % (sizeof(Register) / sizeof(float)); \
+  const Register *end = reinterpret_cast<const Register*>(end_reg); \
+  const Register sign = set1_ps<Register>(-0.f); \
+  const Register scale = set1_ps<Register>(bins_per_unit); \
+  const Register last = set1_ps<Register>(static_cast<float>(bins - 1)); \
+  typedef decltype(cvttps_epi32(scale)) Integers; \
+  int32_t indices[sizeof(Register) / sizeof(float)]; \
+  for (; begin != end; ++begin) { \
+    /* min_ps returns its second argument for NaN. */ \
+    Register scaled = min_ps(mul_ps(andnot_ps(sign, *begin), scale), last); \
+    storeu_si(reinterpret_cast<Integers*>(indices), cvttps_epi32(scaled)); \
+    for (std::size_t i = 0; i < sizeof(Register) / sizeof(float); ++i) \
+      ++counts[indices[i]]; \
+  } \
+  for (const float *i = end_reg; i < end_float; ++i) { \
+    float scaled = std::fabs(*i) * bins_per_unit; \
+    ++counts[scaled < static_cast<float>(bins - 1) ? static_cast<Index>(scaled) : bins - 1]; \
+  } \
+} \
+
+/* Asymmetric quantization to unsigned 8-bit: round(x * quant_mult) + zero_point
+ * saturated to [0, 255].  With zero_point = 127 this matches QuantizeU except
+ * that -128 is not banned.  Output need not be aligned; the tail is scalar.
+ */
+#define INTGEMM_QUANTIZEZEROPOINT(Register, target) \
+target static inline void QuantizeZeroPoint(const float *input, uint8_t *output, float quant_mult, uint8_t zero_point, Index size) { \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
+  const Register quant_mult_reg = set1_ps<Register>(quant_mult); \
+  typedef decltype(cvtps_epi32(quant_mult_reg)) Integers; \
+  const Integers zero_point_reg = set1_epi32<Integers>(zero_point); \
+  const Index kBatch = sizeof(Integers); \
+  const Index fast_end = size & ~(kBatch - 1); \
+  const Register *in = reinterpret_cast<const Register*>(input); \
+  for (Index i = 0; i < fast_end; i += kBatch, in += 4) { \
+    Integers q0 = add_epi32(kernels::quantize(in[0], quant_mult_reg), zero_point_reg); \
+    Integers q1 = add_epi32(kernels::quantize(in[1], quant_mult_reg), zero_point_reg); \
+    Integers q2 = add_epi32(kernels::quantize(in[2], quant_mult_reg), zero_point_reg); \
+    Integers q3 = add_epi32(kernels::quantize(in[3], quant_mult_reg), zero_point_reg); \
+    storeu_si(reinterpret_cast<Integers*>(output + i), kernels::downcast32to8u(q0, q1, q2, q3)); \
+  } \
+  for (Index i = fast_end; i < size; ++i) { \
+    float rounded = std::nearbyint(input[i] * quant_mult) + static_cast<float>(zero_point); \
+    output[i] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, rounded))); \
+  } \
+} \
+
+/* Quantize a rows x cols matrix to int8 with a multiplier per column:
+ * output[r][c] = round(input[r][c] * (quant_mult * column_mults[c])), saturated
+ * to [-127, 127] like Quantize.  Applies smoothing scales to A in the same pass
+ * as quantization (Int8::PrepareASmooth).  Rows need not be aligned.
+ */
+#define INTGEMM_QUANTIZECOLUMNSCALED(Register, target) \
+target static inline void QuantizeColumnScaled(const float *input, int8_t *output, float quant_mult, const float *column_mults, Index rows, Index cols) { \
+  const Register quant_mult_reg = set1_ps<Register>(quant_mult); \
+  const Register clip = set1_ps<Register>(127.0f); \
+  const Register neg_clip = set1_ps<Register>(-127.0f); \
+  typedef decltype(cvtps_epi32(quant_mult_reg)) Integers; \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index kBatch = sizeof(Integers); \
+  const Index fast_end = cols & ~(kBatch - 1); \
+  for (Index r = 0; r < rows; ++r) { \
+    const float *in = input + r * cols; \
+    int8_t *out = output + r * cols; \
+    for (Index c = 0; c < fast_end; c += kBatch) { \
+      Integers q[4]; \
+      for (Index i = 0; i < 4; ++i) { \
+        Register mult = mul_ps(quant_mult_reg, loadu_ps<Register>(column_mults + c + i * kLanes)); \
+        Register scaled = mul_ps(loadu_ps<Register>(in + c + i * kLanes), mult); \
+        q[i] = cvtps_epi32(max_ps(neg_clip, min_ps(clip, scaled))); \
+      } \
+      storeu_si(reinterpret_cast<Integers*>(out + c), kernels::downcast32to8(q[0], q[1], q[2], q[3])); \
+    } \
+    for (Index c = fast_end; c < cols; ++c) { \
+      float rounded = std::nearbyint(in[c] * (quant_mult * column_mults[c])); \
+      out[c] = static_cast<int8_t>(std::min(127.0f, std::max(-127.0f, rounded))); \
+    } \
+  } \
+} \
+
+/* output[r][c] = round(input[r][c] * row_mults[r]), saturated to [-127, 127]
+ * like Quantize: QuantizeColumnScaled with a multiplier per row instead.
+ * Quantizes B with row scales (Int8::PrepareBSmooth) before it is rearranged.
+ * QuantizeRowScaled16 saturates to the int16_t range instead.  Neither uses OpenMP, so
+ * they can quantize rows from inside a parallel loop (PrepareANormRows).
+ */
+#define INTGEMM_QUANTIZEROWSCALED(Register, target) \
+target static inline void QuantizeRowScaled(const float *input, int8_t *output, const float *row_mults, Index rows, Index cols) { \
+  const Register clip = set1_ps<Register>(127.0f); \
+  const Register neg_clip = set1_ps<Register>(-127.0f); \
+  typedef decltype(cvtps_epi32(clip)) Integers; \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index kBatch = sizeof(Integers); \
+  const Index fast_end = cols & ~(kBatch - 1); \
+  for (Index r = 0; r < rows; ++r) { \
+    const float *in = input + r * cols; \
+    int8_t *out = output + r * cols; \
+    const Register mult = set1_ps<Register>(row_mults[r]); \
+    for (Index c = 0; c < fast_end; c += kBatch) { \
+      Integers q[4]; \
+      for (Index i = 0; i < 4; ++i) { \
+        Register scaled = mul_ps(loadu_ps<Register>(in + c + i * kLanes), mult); \
+        q[i] = cvtps_epi32(max_ps(neg_clip, min_ps(clip, scaled))); \
+      } \
+      storeu_si(reinterpret_cast<Integers*>(out + c), kernels::downcast32to8(q[0], q[1], q[2], q[3])); \
+    } \
+    for (Index c = fast_end; c < cols; ++c) { \
+      float rounded = std::nearbyint(in[c] * row_mults[r]); \
+      out[c] = static_cast<int8_t>(std::min(127.0f, std::max(-127.0f, rounded))); \
+    } \
+  } \
+} \
+target static inline void QuantizeRowScaled16(const float *input, int16_t *output, const float *row_mults, Index rows, Index cols) { \
+  const Register clip = set1_ps<Register>(32767.0f); \
+  const Register neg_clip = set1_ps<Register>(-32768.0f); \
+  typedef decltype(cvtps_epi32(clip)) Integers; \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index kBatch = 2 * kLanes; \
+  const Index fast_end = cols & ~(kBatch - 1); \
+  for (Index r = 0; r < rows; ++r) { \
+    const float *in = input + r * cols; \
+    int16_t *out = output + r * cols; \
+    const Register mult = set1_ps<Register>(row_mults[r]); \
+    for (Index c = 0; c < fast_end; c += kBatch) { \
+      Integers low = cvtps_epi32(max_ps(neg_clip, min_ps(clip, mul_ps(loadu_ps<Register>(in + c), mult)))); \
+      Integers high = cvtps_epi32(max_ps(neg_clip, min_ps(clip, mul_ps(loadu_ps<Register>(in + c + kLanes), mult)))); \
+      storeu_si(reinterpret_cast<Integers*>(out + c), kernels::downcast32to16(low, high)); \
+    } \
+    for (Index c = fast_end; c < cols; ++c) { \
+      float rounded = std::nearbyint(in[c] * row_mults[r]); \
+      out[c] = static_cast<int16_t>(std::min(32767.0f, std::max(-32768.0f, rounded))); \
+    } \
+  } \
+} \
+
+/* Randomized Hadamard rotation along the shared dimension (Int8::PrepareAHadamard
+ * and Int8::PrepareBHadamard).  Each block of block consecutive values is
+ * multiplied by signs (+1 or -1 per position) and then by the Hadamard matrix
+ * of size block, which spreads an outlier over the whole block.  Rotating
+ * both A and B and dividing each by sqrt(block) preserves A * B.
+ */
+#define INTGEMM_HADAMARD(Register, target) \
+/* Unnormalized transform of input * signs (size floats, a power of 2 and at \
+ * least four registers) into aligned output.  The lane stages and the first \
+ * two register stages run in registers four at a time as the input is read; \
+ * the rest go over output two stages per pass (radix 4). */ \
+target static inline void HadamardBlock(const float *input, const float *signs, float *output, Index size) { \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index regs = size / kLanes; \
+  Register *reg = reinterpret_cast<Register*>(output); \
+  for (Index i = 0; i < regs; i += 4) { \
+    const float *in = input + i * kLanes, *sign = signs + i * kLanes; \
+    Register a0 = HadamardInRegister(mul_ps(loadu_ps<Register>(in), loadu_ps<Register>(sign))); \
+    Register a1 = HadamardInRegister(mul_ps(loadu_ps<Register>(in + kLanes), loadu_ps<Register>(sign + kLanes))); \
+    Register a2 = HadamardInRegister(mul_ps(loadu_ps<Register>(in + 2 * kLanes), loadu_ps<Register>(sign + 2 * kLanes))); \
+    Register a3 = HadamardInRegister(mul_ps(loadu_ps<Register>(in + 3 * kLanes), loadu_ps<Register>(sign + 3 * kLanes))); \
+    Register b0 = add_ps(a0, a1), b1 = sub_ps(a0, a1), b2 = add_ps(a2, a3), b3 = sub_ps(a2, a3); \
+    reg[i] = add_ps(b0, b2); \
+    reg[i + 1] = add_ps(b1, b3); \
+    reg[i + 2] = sub_ps(b0, b2); \
+    reg[i + 3] = sub_ps(b1, b3); \
+  } \
+  Index h = 4; \
+  for (; 4 * h <= regs; h *= 4) { \
+    for (Index i = 0; i < regs; i += 4 * h) { \
+      for (Register *r = reg + i; r != reg + i + h; ++r) { \
+        Register b0 = add_ps(r[0], r[h]), b1 = sub_ps(r[0], r[h]); \
+        Register b2 = add_ps(r[2 * h], r[3 * h]), b3 = sub_ps(r[2 * h], r[3 * h]); \
+        r[0] = add_ps(b0, b2); \
+        r[h] = add_ps(b1, b3); \
+        r[2 * h] = sub_ps(b0, b2); \
+        r[3 * h] = sub_ps(b1, b3); \
+      } \
+    } \
+  } \
+  if (h < regs) { \
+    for (Register *r = reg; r != reg + h; ++r) { \
+      Register a = r[0], b = r[h]; \
+      r[0] = add_ps(a, b); \
+      r[h] = sub_ps(a, b); \
+    } \
+  } \
+} \
+\
+/* Rotate each block of each row of a row-major matrix in place, divided by \
+ * sqrt(block).  block is a power of 2, at least 64, and divides cols. */ \
+target static inline void RotateHadamard(float *data, const float *signs, Index block, Index rows, Index cols) { \
+  assert(block >= 64 && (block & (block - 1)) == 0 && cols % block == 0); \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Register norm = set1_ps<Register>(1.0f / std::sqrt(static_cast<float>(block))); \
+  AlignedVector<float> scratch(block); \
+  Register *reg = reinterpret_cast<Register*>(scratch.begin()); \
+  for (Index r = 0; r < rows; ++r) { \
+    for (Index b = 0; b < cols; b += block) { \
+      float *row = data + r * cols + b; \
+      HadamardBlock(row, signs + b, scratch.begin(), block); \
+      for (Index c = 0; c < block; c += kLanes) { \
+        storeu_ps(row + c, mul_ps(reg[c / kLanes], norm)); \
+      } \
+    } \
+  } \
+} \
+\
+/* Same as RotateHadamard into an L1-sized buffer, then quantize from there, \
+ * so A is read once.  Saturates to [-127, 127] like Quantize. */ \
+target static inline void QuantizeHadamard(const float *input, int8_t *output, float quant_mult, const float *signs, Index block, Index rows, Index cols) { \
+  assert(block >= 64 && (block & (block - 1)) == 0 && cols % block == 0); \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Register quant_mult_reg = set1_ps<Register>(quant_mult / std::sqrt(static_cast<float>(block))); \
+  const Register clip = set1_ps<Register>(127.0f); \
+  const Register neg_clip = set1_ps<Register>(-127.0f); \
+  typedef decltype(cvtps_epi32(quant_mult_reg)) Integers; \
+  AlignedVector<float> scratch(block); \
+  Register *reg = reinterpret_cast<Register*>(scratch.begin()); \
+  for (Index r = 0; r < rows; ++r) { \
+    for (Index b = 0; b < cols; b += block) { \
+      HadamardBlock(input + r * cols + b, signs + b, scratch.begin(), block); \
+      Integers *out = reinterpret_cast<Integers*>(output + r * cols + b); \
+      for (Index c = 0; c < block / kLanes; c += 4, ++out) { \
+        Integers q[4]; \
+        for (Index i = 0; i < 4; ++i) { \
+          q[i] = cvtps_epi32(max_ps(neg_clip, min_ps(clip, mul_ps(reg[c + i], quant_mult_reg)))); \
+        } \
+        storeu_si(out, kernels::downcast32to8(q[0], q[1], q[2], q[3])); \
+      } \
+    } \
+  } \
+} \
+
+
+/* Normalization of one row for Int8::PrepareANorm and friends:
+ * output = (input - mean) * scale * gamma + beta, with beta optional.
+ * Returns the largest absolute output, so a multiplier can be chosen without
+ * reading output again.
+ */
+#define INTGEMM_NORMALIZEROW(Register, target) \
+target static inline float NormalizeRow(const float *input, const float *gamma, const float *beta, float mean, float scale, Index cols, float *output) { \
+  const Index kLanes = sizeof(Register) / sizeof(float); \
+  const Index simd_cols = cols - cols % kLanes; \
+  const Register mean_reg = set1_ps<Register>(mean); \
+  const Register scale_reg = set1_ps<Register>(scale); \
+  const Register sign = set1_ps<Register>(-0.f); \
+  Register max = setzero_ps<Register>(); \
+  if (beta) { \
+    for (Index c = 0; c < simd_cols; c += kLanes) { \
+      Register x = mul_ps(mul_ps(sub_ps(loadu_ps<Register>(input + c), mean_reg), scale_reg), loadu_ps<Register>(gamma + c)); \
+      x = add_ps(x, loadu_ps<Register>(beta + c)); \
+      storeu_ps(output + c, x); \
+      max = max_ps(max, andnot_ps(sign, x)); \
     } \
   } else { \
-    for (; begin != end; begin++) { \
-      Register vec = *begin; \
-      squares = add_ps(squares, mul_ps(vec, vec)); \
-      sums = add_ps(sums, vec); \
+    for (Index c = 0; c < simd_cols; c += kLanes) { \
+      Register x = mul_ps(mul_ps(sub_ps(loadu_ps<Register>(input + c), mean_reg), scale_reg), loadu_ps<Register>(gamma + c)); \
+      storeu_ps(output + c, x); \
+      max = max_ps(max, andnot_ps(sign, x)); \
     } \
   } \
-  float squares_sum = horizontalSum(squares); \
-  float normal_sums = horizontalSum(sums); \
-  MeanStd ret; \
-  ret.mean = normal_sums/num_items; \
-  ret.stddev = std::sqrt((squares_sum/num_items) - (ret.mean*ret.mean)); \
+  float ret = MaxFloat32(max); \
+  for (Index c = simd_cols; c < cols; ++c) { \
+    output[c] = (input[c] - mean) * scale * gamma[c] + (beta ? beta[c] : 0.0f); \
+    ret = std::max(ret, std::fabs(output[c])); \
+  } \
   return ret; \
 } \
 
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "aligned.h"
+#include "types.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+/* Prepared B that owns its storage and remembers what it is: shape,
+ * quant_mult, the CPU it was prepared for and, for 8-bit, the sum of each
+ * column, which Int8::PrepareBOwned computes in the same pass as PrepareB.
+ *
+ *   intgemm::PreparedB<int8_t> B = intgemm::Int8Shift::PrepareBOwned(B_float, quant_mult, rows, cols);
+ *   intgemm::Int8Shift::PrepareBias(B, unquant_mult, bias, shifted_bias);  // Once
+ *   intgemm::Int8Shift::Multiply(A_prepared, B, A_rows, intgemm::callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, shifted_bias, C));
+ *
+ * The Multiply overloads taking a PreparedB read width and B_cols from it and
+ * throw PreparedBLayoutMismatch if it was prepared for a register width other
+ * than kCPU's.
+ */
+
+namespace intgemm {
+
+class PreparedBLayoutMismatch : public std::runtime_error {
+  public:
+    PreparedBLayoutMismatch(Index prepared, Index expected)
+      : std::runtime_error("Prepared B has the layout of " + std::to_string(prepared) + "-byte registers but this CPU uses " + std::to_string(expected)) {}
+};
+
+template <class Integer> class PreparedB {
+  public:
+    // Uninitialized storage for B prepared on cpu.
+    PreparedB(Index rows, Index cols, float quant_mult, CPUType cpu = kCPU)
+      : data_(rows * cols), column_sums_(sizeof(Integer) == 1 ? cols : 0),
+        rows_(rows), cols_(cols), quant_mult_(quant_mult), cpu_(cpu), layout_(PreparedBLayout(cpu, sizeof(Integer))) {}
+
+    Integer *begin() { return data_.begin(); }
+    const Integer *begin() const { return data_.begin(); }
+    const Integer *get() const { return data_.begin(); }
+
+    Index Rows() const { return rows_; }
+    Index Cols() const { return cols_; }
+    float QuantMult() const { return quant_mult_; }
+    CPUType CPU() const { return cpu_; }
+    // Register width of the layout, as returned by PreparedBLayout.
+    Index Layout() const { return layout_; }
+
+    // Sum of each column of the quantized B (8-bit only, else nullptr).
+    float *ColumnSums() { return column_sums_.size() ? column_sums_.begin() : nullptr; }
+    const float *ColumnSums() const { return column_sums_.size() ? column_sums_.begin() : nullptr; }
+
+    // Bytes owned: the prepared B and any column sums.
+    std::size_t Bytes() const { return data_.size() * sizeof(Integer) + column_sums_.size() * sizeof(float); }
+
+    void CheckLayout() const {
+      Index expected = PreparedBLayout(kCPU, sizeof(Integer));
+      if (layout_ != expected) throw PreparedBLayoutMismatch(layout_, expected);
+    }
+
+  private:
+    AlignedVector<Integer> data_;
+    AlignedVector<float> column_sums_;
+    Index rows_, cols_;
+    float quant_mult_;
+    CPUType cpu_;
+    Index layout_;
+};
+
+} // namespace intgemm
@@ -0,0 +1,147 @@
+#include "prepared_cache.h"
+
+#include <cstring>
+#include <random>
+
+namespace intgemm {
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+uint64_t RotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t Round(uint64_t accumulator, uint64_t word) {
+  return RotateLeft(accumulator + word * kPrime2, 31) * kPrime1;
+}
+
+uint64_t Finalize(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// Four independent lanes in the style of xxHash64 so the multiplies pipeline;
+// a hit costs about a third of PrepareB.  The 256 bits of lane state are
+// folded two different ways into the two halves of a 128-bit hash.
+void HashBytes(const void *data, std::size_t size, uint64_t seed, uint64_t *hash) {
+  const char *bytes = static_cast<const char*>(data);
+  uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1};
+  std::size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    for (int k = 0; k < 4; ++k) {
+      uint64_t word;
+      std::memcpy(&word, bytes + i + 8 * k, 8);
+      lanes[k] = Round(lanes[k], word);
+    }
+  }
+  uint64_t low = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+  uint64_t high = Round(Round(Round(Round(seed ^ kPrime2, lanes[3]), lanes[2]), lanes[1]), lanes[0]);
+  for (; i < size; ++i) {
+    low = Round(low, static_cast<unsigned char>(bytes[i]));
+    high = Round(high, static_cast<unsigned char>(bytes[i]) ^ kPrime1);
+  }
+  hash[0] = Finalize(low ^ size);
+  hash[1] = Finalize(high + size * kPrime1);
+}
+
+uint64_t RandomSeed() {
+  std::random_device device;
+  return (uint64_t(device()) << 32) ^ device();
+}
+
+} // namespace
+
+PreparedBCache::PreparedBCache(std::size_t budget) : seed_(RandomSeed()), budget_(budget), bytes_(0), hits_(0), misses_(0) {}
+
+PreparedBCache &PreparedBCache::Global() {
+  static PreparedBCache cache(std::size_t(1) << 30);
+  return cache;
+}
+
+PreparedBCache::Key PreparedBCache::MakeKey(const float *input, float quant_mult, Index rows, Index cols, uint32_t integer_bytes) const {
+  Key key;
+  HashBytes(input, std::size_t(rows) * cols * sizeof(float), seed_, key.hash);
+  key.rows = rows;
+  key.cols = cols;
+  std::memcpy(&key.quant_mult, &quant_mult, sizeof(quant_mult));
+  key.integer_bytes = integer_bytes;
+  key.layout = PreparedBLayout(kCPU, integer_bytes);
+  return key;
+}
+
+std::shared_ptr<const void> PreparedBCache::Find(const Key &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = entries_.find(key);
+  if (found == entries_.end()) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  lru_.splice(lru_.begin(), lru_, found->second.lru);
+  return found->second.data;
+}
+
+std::shared_ptr<const void> PreparedBCache::Insert(const Key &key, std::shared_ptr<const void> data, std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = entries_.find(key);
+  if (found != entries_.end()) return found->second.data;
+  lru_.push_front(key);
+  Entry &entry = entries_[key];
+  entry.data = data;
+  entry.bytes = bytes;
+  entry.lru = lru_.begin();
+  bytes_ += bytes;
+  EvictToBudget();
+  return data;
+}
+
+void PreparedBCache::EvictToBudget() {
+  while (bytes_ > budget_) {
+    auto evict = entries_.find(lru_.back());
+    bytes_ -= evict->second.bytes;
+    entries_.erase(evict);
+    lru_.pop_back();
+  }
+}
+
+void PreparedBCache::SetBudget(std::size_t budget) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = budget;
+  EvictToBudget();
+}
+
+void PreparedBCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  lru_.clear();
+  bytes_ = 0;
+}
+
+std::size_t PreparedBCache::Budget() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_;
+}
+
+std::size_t PreparedBCache::Bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+uint64_t PreparedBCache::Hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+uint64_t PreparedBCache::Misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+} // namespace intgemm
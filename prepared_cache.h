@@ -0,0 +1,111 @@
+#pragma once
+
+#include "prepared_b.h"
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/* Process-wide cache of prepared B, so models loaded by several components and
+ * matrices that are prepared again every step (e.g. encoder outputs reused by
+ * each decoder step) are prepared once:
+ *
+ *   std::shared_ptr<const intgemm::PreparedB<int8_t> > B = intgemm::PreparedBCache::Global().PrepareB<intgemm::Int8>(B_float, quant_mult, rows, cols);
+ *   intgemm::Int8::Multiply(A_prepared, *B, A_rows, callback);
+ *
+ * Entries are keyed by a 128-bit hash of the float B with its shape, quant_mult,
+ * Integer type and the prepared layout of kCPU, so the float B is hashed on
+ * every call but never stored.  The float B is not compared, so two
+ * different B of the same shape that collide would share one prepared B.
+ * For unrelated inputs that happens with probability about 2^-128 per pair.
+ * The hash is seeded at random per cache but is not cryptographic, so do not
+ * cache B chosen by someone trying to forge a collision; prepare those
+ * directly.  Handles are shared pointers: an entry
+ * evicted to stay within the byte budget lives on until its last handle is
+ * destroyed, but no longer counts against the budget.  All members are thread
+ * safe.
+ */
+
+namespace intgemm {
+
+class PreparedBCache {
+  public:
+    // Keep at most budget bytes of prepared B, evicting the least recently used.
+    explicit PreparedBCache(std::size_t budget);
+
+    PreparedBCache(const PreparedBCache &) = delete;
+    PreparedBCache &operator=(const PreparedBCache &) = delete;
+
+    // The process-wide cache, with a budget of 1 GiB until SetBudget.
+    static PreparedBCache &Global();
+
+    // Routine::PrepareBOwned(input, quant_mult, rows, cols) unless the same
+    // input was already prepared that way.  Concurrent misses on the same key
+    // may both prepare; one result is kept.
+    template <class Routine> std::shared_ptr<const PreparedB<typename Routine::Integer> > PrepareB(const float *input, float quant_mult, Index rows, Index cols) {
+      typedef PreparedB<typename Routine::Integer> Prepared;
+      const Key key = MakeKey(input, quant_mult, rows, cols, sizeof(typename Routine::Integer));
+      std::shared_ptr<const void> found = Find(key);
+      if (!found) {
+        std::shared_ptr<const Prepared> prepared = std::make_shared<Prepared>(Routine::PrepareBOwned(input, quant_mult, rows, cols));
+        found = Insert(key, prepared, prepared->Bytes());
+      }
+      return std::static_pointer_cast<const Prepared>(found);
+    }
+
+    // Change the budget, evicting as needed.
+    void SetBudget(std::size_t budget);
+    // Drop all entries.  Outstanding handles remain valid.
+    void Clear();
+
+    std::size_t Budget() const;
+    // Bytes of prepared B, with column sums, held by the cache.
+    std::size_t Bytes() const;
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+
+  private:
+    struct Key {
+      uint64_t hash[2];
+      Index rows, cols;
+      // Bits of quant_mult, so that a NaN quant_mult still equals itself.
+      uint32_t quant_mult;
+      uint32_t integer_bytes;
+      Index layout;
+      bool operator==(const Key &other) const {
+        return hash[0] == other.hash[0] && hash[1] == other.hash[1] && rows == other.rows && cols == other.cols && quant_mult == other.quant_mult &&
+          integer_bytes == other.integer_bytes && layout == other.layout;
+      }
+    };
+    struct KeyHash {
+      std::size_t operator()(const Key &key) const { return static_cast<std::size_t>(key.hash[0]); }
+    };
+    struct Entry {
+      std::shared_ptr<const void> data;
+      std::size_t bytes;
+      std::list<Key>::iterator lru;
+    };
+
+    Key MakeKey(const float *input, float quant_mult, Index rows, Index cols, uint32_t integer_bytes) const;
+    // The cached data for key, marking it most recently used, or nullptr.
+    std::shared_ptr<const void> Find(const Key &key);
+    // Cache data of bytes bytes under key, or return what another thread cached first.
+    std::shared_ptr<const void> Insert(const Key &key, std::shared_ptr<const void> data, std::size_t bytes);
+    // Requires mutex_.
+    void EvictToBudget();
+
+    // Keys the hash, so collisions differ from process to process.
+    const uint64_t seed_;
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    // Most recently used first.
+    std::list<Key> lru_;
+    std::size_t budget_, bytes_;
+    uint64_t hits_, misses_;
+};
+
+} // namespace intgemm
@@ -0,0 +1,179 @@
+#include "prepared_file.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace intgemm {
+
+namespace {
+
+const char kMagic[8] = {'i', 'n', 't', 'g', 'e', 'm', 'm', 'B'};
+
+uint64_t RoundUp64(uint64_t offset) {
+  return (offset + 63) & ~uint64_t(63);
+}
+
+std::string SystemError(const char *what, const char *path) {
+  return std::string(what) + " " + path + ": " + std::strerror(errno);
+}
+
+void WriteAt(std::FILE *file, const char *path, uint64_t offset, const void *data, std::size_t size) {
+  // Zero padding up to offset.
+  static const char zeros[64] = {0};
+  long at = std::ftell(file);
+  if (at < 0 || uint64_t(at) > offset || std::fwrite(zeros, 1, offset - at, file) != offset - at || std::fwrite(data, 1, size, file) != size)
+    throw PreparedFileError(SystemError("Writing", path));
+}
+
+PreparedBHeader MakeHeader(uint32_t integer_bytes, Index rows, Index cols, float quant_mult, bool with_bias) {
+  PreparedBHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kPreparedBVersion;
+  header.integer_bytes = integer_bytes;
+  header.cpu = static_cast<uint32_t>(kCPU);
+  header.register_bytes = PreparedBLayout(kCPU, integer_bytes);
+  header.rows = rows;
+  header.cols = cols;
+  header.quant_mult = quant_mult;
+  header.bias_count = with_bias ? cols : 0;
+  header.data_offset = RoundUp64(sizeof(header));
+  header.bias_offset = with_bias ? RoundUp64(header.data_offset + uint64_t(rows) * cols * integer_bytes) : 0;
+  return header;
+}
+
+// Whether count elements of element_bytes each fit between offset and size.
+// Written so that a corrupt offset or count cannot wrap around.
+bool FitsIn(uint64_t offset, uint64_t count, uint64_t element_bytes, uint64_t size) {
+  return offset <= size && count <= (size - offset) / element_bytes;
+}
+
+// Bytes needed for the file described by header.
+uint64_t TotalSize(const PreparedBHeader &header) {
+  return header.bias_count ? header.bias_offset + uint64_t(header.bias_count) * sizeof(float) : header.data_offset + uint64_t(header.rows) * header.cols * header.integer_bytes;
+}
+
+template <class Integer> void WritePreparedBImpl(const char *path, const Integer *prepared, Index rows, Index cols, float quant_mult, const float *bias) {
+  const PreparedBHeader header = MakeHeader(sizeof(Integer), rows, cols, quant_mult, bias != nullptr);
+  // No layout: this CPU cannot have prepared B.
+  if (!header.register_bytes) throw UnsupportedCPU();
+  std::FILE *file = std::fopen(path, "wb");
+  if (!file) throw PreparedFileError(SystemError("Opening", path));
+  try {
+    WriteAt(file, path, 0, &header, sizeof(header));
+    WriteAt(file, path, header.data_offset, prepared, uint64_t(rows) * cols * sizeof(Integer));
+    if (bias) WriteAt(file, path, header.bias_offset, bias, cols * sizeof(float));
+  } catch (...) {
+    std::fclose(file);
+    throw;
+  }
+  if (std::fclose(file)) throw PreparedFileError(SystemError("Closing", path));
+}
+
+} // namespace
+
+void WritePreparedB(const char *path, const int8_t *prepared, Index rows, Index cols, float quant_mult, const float *bias) {
+  WritePreparedBImpl(path, prepared, rows, cols, quant_mult, bias);
+}
+
+void WritePreparedB(const char *path, const int16_t *prepared, Index rows, Index cols, float quant_mult, const float *bias) {
+  WritePreparedBImpl(path, prepared, rows, cols, quant_mult, bias);
+}
+
+PreparedBFile::PreparedBFile(const char *path, Source source) {
+  int fd = source == kSharedMemory ? shm_open(path, O_RDONLY, 0) : open(path, O_RDONLY);
+  if (fd < 0) throw PreparedFileError(SystemError("Opening", path));
+  struct stat info;
+  if (fstat(fd, &info)) {
+    std::string message = SystemError("Reading", path);
+    close(fd);
+    throw PreparedFileError(message);
+  }
+  size_ = info.st_size;
+  if (size_ < sizeof(PreparedBHeader)) {
+    close(fd);
+    throw PreparedFileError(std::string(path) + " is too short to be a prepared B");
+  }
+  void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  std::string map_error = SystemError("Mapping", path);
+  close(fd);
+  if (mapped == MAP_FAILED) throw PreparedFileError(map_error);
+  base_ = static_cast<const char*>(mapped);
+
+  const PreparedBHeader &header = Header();
+  std::string error;
+  uint32_t layout = PreparedBLayout(kCPU, header.integer_bytes);
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic))) {
+    error = " is not a prepared B";
+  } else if (header.version != kPreparedBVersion) {
+    error = " has version " + std::to_string(header.version) + ", expected " + std::to_string(kPreparedBVersion);
+  } else if (header.integer_bytes != 1 && header.integer_bytes != 2) {
+    error = " has " + std::to_string(header.integer_bytes) + "-byte integers";
+  } else if (!layout) {
+    error = " holds " + std::to_string(header.integer_bytes) + "-byte B, which this CPU cannot multiply";
+  } else if (header.register_bytes != layout) {
+    error = " was prepared for " + std::to_string(header.register_bytes) + "-byte registers (CPUType " + std::to_string(header.cpu) + ") but this CPU uses " + std::to_string(layout);
+  } else if (header.data_offset % 64 || header.bias_offset % 64 ||
+      !FitsIn(header.data_offset, uint64_t(header.rows) * header.cols, header.integer_bytes, size_) ||
+      (header.bias_count && (header.bias_count != header.cols || !FitsIn(header.bias_offset, header.bias_count, sizeof(float), size_)))) {
+    error = " is truncated or corrupt";
+  }
+  if (!error.empty()) {
+    munmap(const_cast<char*>(base_), size_);
+    throw PreparedFileError(path + error);
+  }
+}
+
+PreparedBFile::~PreparedBFile() {
+  munmap(const_cast<char*>(base_), size_);
+}
+
+SharedPreparedB::SharedPreparedB(const char *name, uint32_t integer_bytes, Index rows, Index cols, float quant_mult, bool with_bias)
+  : name_(name), committed_(false) {
+  if (integer_bytes != 1 && integer_bytes != 2) throw PreparedFileError("Prepared B has 1 or 2-byte integers, not " + std::to_string(integer_bytes));
+  if (!PreparedBLayout(kCPU, integer_bytes)) throw UnsupportedCPU();
+  const PreparedBHeader header = MakeHeader(integer_bytes, rows, cols, quant_mult, with_bias);
+  size_ = TotalSize(header);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) throw PreparedFileError(SystemError("Creating", name));
+  if (ftruncate(fd, size_)) {
+    std::string message = SystemError("Sizing", name);
+    close(fd);
+    shm_unlink(name);
+    throw PreparedFileError(message);
+  }
+  void *mapped = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  std::string map_error = SystemError("Mapping", name);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    shm_unlink(name);
+    throw PreparedFileError(map_error);
+  }
+  base_ = static_cast<char*>(mapped);
+  // Everything but the magic, which Commit writes last so readers never see a partial B.
+  std::memcpy(base_ + sizeof(kMagic), reinterpret_cast<const char*>(&header) + sizeof(kMagic), sizeof(header) - sizeof(kMagic));
+}
+
+SharedPreparedB::~SharedPreparedB() {
+  munmap(base_, size_);
+  if (!committed_) shm_unlink(name_.c_str());
+}
+
+void SharedPreparedB::Commit() {
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(base_, kMagic, sizeof(kMagic));
+  committed_ = true;
+}
+
+void RemoveSharedPreparedB(const char *name) {
+  if (shm_unlink(name)) throw PreparedFileError(SystemError("Removing", name));
+}
+
+} // namespace intgemm
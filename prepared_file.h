@@ -0,0 +1,148 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/* On-disk format for prepared B, so a model can be served without running
+ * PrepareB at load time.  The file is a 64-byte PreparedBHeader followed by the
+ * prepared B and optionally a float per column (e.g. the output of
+ * Int8Shift::PrepareBias), each starting on a 64-byte boundary so a mapping
+ * can be used in place:
+ *
+ *   intgemm::WritePreparedB("W.bin", B_prepared, rows, cols, quant_mult);
+ *   ...
+ *   intgemm::PreparedBFile file("W.bin");
+ *   intgemm::Int8::Multiply(A_prepared, file.B<int8_t>(), A_rows, file.Rows(), file.Cols(), callback);
+ *
+ * The layout of prepared B depends on the register width of the CPU that
+ * prepared it, so the loader refuses a file whose layout does not match kCPU.
+ * Numbers are stored in the byte order of the machine that wrote them.
+ *
+ * Read-only mappings of one file all use its pages in the page cache, so
+ * worker processes mapping the same file share one copy of B.  To skip the file, prepare B straight into a
+ * POSIX shared memory object in the same format and attach to it by name:
+ *
+ *   intgemm::SharedPreparedB shared("/model-W", sizeof(int8_t), rows, cols, quant_mult);
+ *   intgemm::Int8::PrepareB(B, shared.B<int8_t>(), quant_mult, rows, cols);
+ *   shared.Commit();
+ *   ...
+ *   intgemm::PreparedBFile file("/model-W", intgemm::PreparedBFile::kSharedMemory);
+ */
+
+namespace intgemm {
+
+class PreparedFileError : public std::runtime_error {
+  public:
+    explicit PreparedFileError(const std::string &message) : std::runtime_error(message) {}
+};
+
+struct PreparedBHeader {
+  char magic[8];            // "intgemmB"
+  uint32_t version;         // kPreparedBVersion
+  uint32_t integer_bytes;   // sizeof(Integer): 1 for Int8 and Int8Shift, 2 for Int16
+  uint32_t cpu;             // CPUType that wrote the file, for error messages
+  uint32_t register_bytes;  // PreparedBLayout of that CPU
+  uint32_t rows;
+  uint32_t cols;
+  float quant_mult;
+  uint32_t bias_count;      // 0 or cols
+  uint64_t data_offset;     // Of B from the start of the file; a multiple of 64
+  uint64_t bias_offset;     // Of the bias; a multiple of 64, 0 without bias
+  char padding[8];
+};
+static_assert(sizeof(PreparedBHeader) == 64, "PreparedBHeader should fill one cache line");
+
+const uint32_t kPreparedBVersion = 1;
+
+// Write B prepared on this CPU (by PrepareB, PrepareBTransposed, ...) with its
+// quant_mult and, unless bias is nullptr, cols floats of bias.  Throws
+// PreparedFileError on I/O errors and UnsupportedCPU if this CPU cannot
+// multiply Integer, since then there is no layout to record.
+void WritePreparedB(const char *path, const int8_t *prepared, Index rows, Index cols, float quant_mult, const float *bias = nullptr);
+void WritePreparedB(const char *path, const int16_t *prepared, Index rows, Index cols, float quant_mult, const float *bias = nullptr);
+
+// Read-only mapping of a file from WritePreparedB or SharedPreparedB.  Nothing is copied or
+// converted: B<Integer>() points into the mapping, which lives as long as the
+// object.  The constructor throws PreparedFileError if the file is not a
+// prepared B of this version, is truncated, or has a layout other than kCPU's,
+// including when kCPU cannot multiply it at all.
+class PreparedBFile {
+  public:
+    enum Source {
+      kFile,         // path is a file name
+      kSharedMemory  // path is a shm_open name written by SharedPreparedB
+    };
+
+    explicit PreparedBFile(const char *path, Source source = kFile);
+    ~PreparedBFile();
+
+    PreparedBFile(const PreparedBFile &) = delete;
+    PreparedBFile &operator=(const PreparedBFile &) = delete;
+
+    const PreparedBHeader &Header() const { return *reinterpret_cast<const PreparedBHeader*>(base_); }
+    Index Rows() const { return Header().rows; }
+    Index Cols() const { return Header().cols; }
+    float QuantMult() const { return Header().quant_mult; }
+
+    // The bias, or nullptr if none was written.
+    const float *Bias() const {
+      return Header().bias_count ? reinterpret_cast<const float*>(base_ + Header().bias_offset) : nullptr;
+    }
+
+    // Prepared B.  Throws PreparedFileError if it was not written as Integer.
+    template <class Integer> const Integer *B() const {
+      if (Header().integer_bytes != sizeof(Integer))
+        throw PreparedFileError("prepared B has " + std::to_string(Header().integer_bytes) + "-byte integers, requested " + std::to_string(sizeof(Integer)));
+      return reinterpret_cast<const Integer*>(base_ + Header().data_offset);
+    }
+
+  private:
+    const char *base_;
+    std::size_t size_;
+};
+
+// Creates the shared memory object name (for shm_open, e.g. "/model-W") with
+// room for a prepared B of rows x cols integer_bytes-byte integers and, if
+// with_bias, cols floats, mapped writable so PrepareB can write into it.
+// Readers only see it after Commit; without Commit the destructor removes the
+// object.  Once committed, the object lasts until RemoveSharedPreparedB, even
+// after this process exits.  Throws PreparedFileError if name exists.
+class SharedPreparedB {
+  public:
+    SharedPreparedB(const char *name, uint32_t integer_bytes, Index rows, Index cols, float quant_mult, bool with_bias = false);
+    ~SharedPreparedB();
+
+    SharedPreparedB(const SharedPreparedB &) = delete;
+    SharedPreparedB &operator=(const SharedPreparedB &) = delete;
+
+    // 64-byte aligned, like AlignedVector.  Throws PreparedFileError unless
+    // Integer has integer_bytes bytes.
+    template <class Integer> Integer *B() {
+      if (Header().integer_bytes != sizeof(Integer))
+        throw PreparedFileError("shared prepared B has " + std::to_string(Header().integer_bytes) + "-byte integers, requested " + std::to_string(sizeof(Integer)));
+      return reinterpret_cast<Integer*>(base_ + Header().data_offset);
+    }
+    // nullptr unless constructed with_bias.
+    float *Bias() {
+      return Header().bias_count ? reinterpret_cast<float*>(base_ + Header().bias_offset) : nullptr;
+    }
+
+    // Publish B and the bias to PreparedBFile(name, PreparedBFile::kSharedMemory).
+    void Commit();
+
+  private:
+    const PreparedBHeader &Header() const { return *reinterpret_cast<const PreparedBHeader*>(base_); }
+
+    std::string name_;
+    char *base_;
+    std::size_t size_;
+    bool committed_;
+};
+
+// shm_unlink a committed SharedPreparedB.  Attached readers keep their mapping.
+void RemoveSharedPreparedB(const char *name);
+
+} // namespace intgemm
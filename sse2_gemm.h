@@ -55,6 +55,20 @@ INTGEMM_MAXABSOLUTE(__m128, INTGEMM_SSE2)
 
 INTGEMM_VECTORMEANSTD(__m128, INTGEMM_SSE2)
 
+INTGEMM_ABSOLUTEHISTOGRAM(__m128, INTGEMM_SSE2)
+
+INTGEMM_QUANTIZEZEROPOINT(__m128, INTGEMM_SSE2)
+
+INTGEMM_ROWSTATISTICS(__m128, INTGEMM_SSE2)
+
+INTGEMM_QUANTIZECOLUMNSCALED(__m128, INTGEMM_SSE2)
+
+INTGEMM_QUANTIZEROWSCALED(__m128, INTGEMM_SSE2)
+
+INTGEMM_HADAMARD(__m128, INTGEMM_SSE2)
+
+INTGEMM_NORMALIZEROW(__m128, INTGEMM_SSE2)
+
 } //namespace
 // This should be pure INTGEMM_SSE2 (and below).
 struct SSE2_16bit {
@@ -69,13 +83,24 @@ struct SSE2_16bit {
     assert(size % 8 == 0);
     assert(reinterpret_cast<uintptr_t>(input) % 16 == 0);
     assert(reinterpret_cast<uintptr_t>(output) % 16 == 0);
+#pragma omp parallel
+    {
+      QuantizeThread(input, output, quant_mult, size);
+    }
+  }
+
+ private:
+  // Split from Quantize for OpenMP like SSSE3_8bit::QuantizeThread.
+  INTGEMM_SSE2 static void QuantizeThread(const float *input, int16_t *output, float quant_mult, std::size_t count) {
     sse2::QuantizeTile16 q(quant_mult);
-    const float *end = input + size;
-    for (; input != end; input += 8, output += 8) {
-      *reinterpret_cast<__m128i*>(output) = q.Consecutive(input);
+#pragma omp for
+    for (std::size_t i = 0; i < count; i += 8) {
+      *reinterpret_cast<__m128i*>(output + i) = q.Consecutive(input + i);
     }
   }
 
+ public:
+
   // Tile size for B; B must be a multiple of this block size.
   static const Index kBTileRow = 8;
   static const Index kBTileCol = 8;
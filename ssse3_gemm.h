@@ -152,6 +152,8 @@ struct SSSE3_8bit {
 
   INTGEMM_MULTIPLY8(__m128i, INTGEMM_SSSE3, CPUType::SSE2)
 
+  INTGEMM_MULTIPLY8GROUPED(__m128i, INTGEMM_SSSE3, CPUType::SSE2)
+
   INTGEMM_MULTIPLY8SHIFT(__m128i, INTGEMM_SSSE3, CPUType::SSE2)
 
   INTGEMM_PREPAREBIASFOR8(__m128i, INTGEMM_SSSE3, CPUType::SSE2)
@@ -474,4 +474,126 @@ TEST_CASE ("Multiply AVX512VNNI 8bit Shift vs Int", "[Add127]") {
 }
 #endif
 
+// Zero point
+template <void (*QuantizeZeroPoint)(const float *, uint8_t *, float, uint8_t, Index)> void TestQuantizeZeroPoint(Index size) {
+  std::mt19937 gen;
+  // Go out of range at both ends.
+  std::uniform_real_distribution<float> dist(-3.0f, 3.0f);
+  AlignedVector<float> input(size);
+  for (auto& it : input) {
+    it = dist(gen);
+  }
+  const float quant_mult = 60.0f;
+  const uint8_t zero_point = 100;
+  AlignedVector<uint8_t> output(size);
+  QuantizeZeroPoint(input.begin(), output.begin(), quant_mult, zero_point, size);
+  for (Index i = 0; i < size; ++i) {
+    float expected = std::nearbyint(input[i] * quant_mult) + zero_point;
+    expected = std::min(255.0f, std::max(0.0f, expected));
+    INFO("Index " << i << " input " << input[i]);
+    CHECK(int(output[i]) == int(expected));
+  }
+}
+
+TEST_CASE("QuantizeZeroPoint SSE2", "[Add127]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestQuantizeZeroPoint<sse2::QuantizeZeroPoint>(64);
+  TestQuantizeZeroPoint<sse2::QuantizeZeroPoint>(71);
+}
+
+TEST_CASE("QuantizeZeroPoint AVX2", "[Add127]") {
+  if (kCPU < CPUType::AVX2) return;
+  TestQuantizeZeroPoint<avx2::QuantizeZeroPoint>(64);
+  TestQuantizeZeroPoint<avx2::QuantizeZeroPoint>(135);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+TEST_CASE("QuantizeZeroPoint AVX512", "[Add127]") {
+  if (kCPU < CPUType::AVX512BW) return;
+  TestQuantizeZeroPoint<avx512f::QuantizeZeroPoint>(64);
+  TestQuantizeZeroPoint<avx512f::QuantizeZeroPoint>(263);
+}
+#endif
+
+// Compares Int8Shift with zero points against an exact integer reference.
+// per_row selects a zero point per row of A instead of one for all of A.
+void TestMultiplyZeroPoint(Index A_rows, Index width, Index B_cols, bool per_row) {
+  std::ostringstream info;
+  info << Int8Shift::kName << "\t" << A_rows << '\t' << width << '\t' << B_cols << '\t' << per_row << '\n';
+
+  // Asymmetric A, e.g. after a shifted activation.
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  AlignedVector<float> bias(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist_A(-0.5f, 2.5f);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist_A(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+  for (auto& it : bias) {
+    it = dist(gen);
+  }
+
+  // Keep |B| <= 64 so pairs of 255 * B don't saturate 16-bit accumulation.
+  const float quant_mult_A = 255.0f / 3.0f;
+  const float quant_mult_B = 64.0f;
+  const float unquant_mult = 1.0f / (quant_mult_A * quant_mult_B);
+
+  AlignedVector<uint8_t> zero_points(A_rows);
+  for (Index r = 0; r < A_rows; ++r) {
+    zero_points[r] = per_row ? static_cast<uint8_t>(20 + 7 * r % 40) : 42;
+  }
+
+  AlignedVector<int8_t> A_prep(A.size());
+  AlignedVector<int8_t> B_prep(B.size());
+  AlignedVector<int8_t> B_quant(B.size());
+  if (per_row) {
+    Int8Shift::PrepareAZeroPoint(A.begin(), A_prep.begin(), quant_mult_A, zero_points.begin(), A_rows, width);
+  } else {
+    Int8Shift::PrepareAZeroPoint(A.begin(), A_prep.begin(), quant_mult_A, zero_points[0], A_rows, width);
+  }
+  Int8Shift::PrepareB(B.begin(), B_prep.begin(), quant_mult_B, width, B_cols);
+  Int8::Quantize(B.begin(), B_quant.begin(), quant_mult_B, B.size());
+
+  AlignedVector<float> test_C(A_rows * B_cols);
+  if (per_row) {
+    AlignedVector<float> column_sums(B_cols);
+    Int8Shift::PrepareColumnSums(B_prep.begin(), width, B_cols, column_sums.begin());
+    Int8Shift::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols,
+        callbacks::UnquantizeAndSubtractZeroPointAndAddBiasAndWrite(unquant_mult, column_sums.begin(), zero_points.begin(), bias.begin(), test_C.begin()));
+  } else {
+    AlignedVector<float> bias_prep(B_cols);
+    Int8Shift::PrepareBiasZeroPoint(B_prep.begin(), width, B_cols, zero_points[0], unquant_mult, bias.begin(), bias_prep.begin());
+    Int8Shift::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols,
+        callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias_prep.begin(), test_C.begin()));
+  }
+
+  const uint8_t *A_unsigned = reinterpret_cast<const uint8_t*>(A_prep.begin());
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < B_cols; ++c) {
+      int32_t sum = 0;
+      for (Index k = 0; k < width; ++k) {
+        sum += (int32_t(A_unsigned[r * width + k]) - zero_points[r]) * B_quant[k * B_cols + c];
+      }
+      float expected = sum * unquant_mult + bias[c];
+      INFO(info.str() << "row " << r << " col " << c);
+      CHECK(test_C[r * B_cols + c] == Approx(expected).margin(1e-3));
+    }
+  }
+}
+
+TEST_CASE("Multiply 8bit Shift with zero point", "[Add127]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyZeroPoint(1, 64, 8, false);
+  TestMultiplyZeroPoint(8, 256, 256, false);
+  TestMultiplyZeroPoint(200, 256, 256, false);
+  TestMultiplyZeroPoint(1, 64, 8, true);
+  TestMultiplyZeroPoint(8, 256, 256, true);
+  TestMultiplyZeroPoint(200, 256, 256, true);
+}
+
 } //namespace intgemm
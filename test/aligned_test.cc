@@ -0,0 +1,53 @@
+#include "test.h"
+#include "../aligned.h"
+
+#include <cstdint>
+#include <utility>
+
+namespace intgemm {
+namespace {
+
+void CheckVector(unsigned flags, std::size_t alignment) {
+  INFO("flags " << flags);
+  const std::size_t size = 3 * 1000 * 1000;
+  AlignedVector<float> vector(size, flags);
+  REQUIRE(vector.size() == size);
+  CHECK(reinterpret_cast<uintptr_t>(vector.begin()) % alignment == 0);
+  for (std::size_t i = 0; i < size; i += 1021) vector[i] = float(i);
+  AlignedVector<float> moved(std::move(vector));
+  CHECK(vector.size() == 0);
+  for (std::size_t i = 0; i < size; i += 1021) CHECK(moved[i] == float(i));
+  AlignedVector<float> assigned(1);
+  assigned = std::move(moved);
+  CHECK(assigned[size - size % 1021] == float(size - size % 1021));
+}
+
+TEST_CASE("AlignedVector allocation flags", "[aligned]") {
+  CheckVector(0, 64);
+  CheckVector(kHugePages, 1 << 21);
+  CheckVector(kHugePages | kPrefault, 1 << 21);
+  // Without a reserved pool this exercises the fallback.
+  CheckVector(kHugeTLB, 1 << 21);
+  CheckVector(kPrefault | kLock, 64);
+}
+
+TEST_CASE("WeightArena", "[aligned]") {
+  WeightArena arena(1000, kHugePages);
+  CHECK(arena.Capacity() == 1000);
+  int8_t *first = arena.Allocate<int8_t>(3);
+  float *second = arena.Allocate<float>(10);
+  int16_t *third = arena.Allocate<int16_t>(8);
+  CHECK(reinterpret_cast<uintptr_t>(first) % 64 == 0);
+  CHECK(reinterpret_cast<char*>(second) - reinterpret_cast<char*>(first) == 64);
+  CHECK(reinterpret_cast<char*>(third) - reinterpret_cast<char*>(first) == 128);
+  CHECK(arena.Used() == 144);
+  CHECK_THROWS_AS(arena.Allocate<char>(1000 - 192 + 1), std::bad_alloc);
+  CHECK(arena.Allocate<char>(1000 - 192) != nullptr);
+  CHECK(arena.Used() == 1000);
+  CHECK_THROWS_AS(arena.Allocate<char>(1), std::bad_alloc);
+  arena.Reset();
+  CHECK(arena.Allocate<int8_t>(1) == first);
+}
+
+} // namespace
+} // namespace intgemm
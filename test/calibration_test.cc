@@ -0,0 +1,157 @@
+#include "test.h"
+#include "../calibration.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace intgemm {
+namespace {
+
+template <void (*Backend)(const float *, const float *, float, Index, uint64_t *)>
+void TestAbsoluteHistogram(Index size) {
+  const Index bins = 64;
+  const float bins_per_unit = 16.0f;
+  AlignedVector<float> input(size);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-5.f, 5.f);
+  for (Index i = 0; i < size; ++i)
+    input[i] = (i == 3) ? std::numeric_limits<float>::infinity() : dist(gen);
+
+  std::vector<uint64_t> reference(bins), actual(bins);
+  for (Index i = 0; i < size; ++i) {
+    float scaled = std::fabs(input[i]) * bins_per_unit;
+    ++reference[scaled < bins - 1 ? static_cast<Index>(scaled) : bins - 1];
+  }
+  Backend(input.begin(), input.end(), bins_per_unit, bins, actual.data());
+  for (Index i = 0; i < bins; ++i)
+    CHECK(actual[i] == reference[i]);
+}
+
+TEST_CASE("AbsoluteHistogram SSE2", "[calibration]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestAbsoluteHistogram<sse2::AbsoluteHistogram>(1024);
+  TestAbsoluteHistogram<sse2::AbsoluteHistogram>(1031);
+}
+
+TEST_CASE("AbsoluteHistogram AVX2", "[calibration]") {
+  if (kCPU < CPUType::AVX2) return;
+  TestAbsoluteHistogram<avx2::AbsoluteHistogram>(1024);
+  TestAbsoluteHistogram<avx2::AbsoluteHistogram>(1031);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+TEST_CASE("AbsoluteHistogram AVX512", "[calibration]") {
+  if (kCPU < CPUType::AVX512BW) return;
+  TestAbsoluteHistogram<avx512f::AbsoluteHistogram>(1024);
+  TestAbsoluteHistogram<avx512f::AbsoluteHistogram>(1031);
+}
+#endif
+
+TEST_CASE("Histogram grows across batches", "[calibration]") {
+  if (kCPU < CPUType::SSE2) return;
+  Histogram histogram(8);
+  AlignedVector<float> batch(16);
+  for (Index i = 0; i < 16; ++i) batch[i] = (i % 2) ? -0.5f : 0.25f;
+  batch[0] = 1.0f;
+  histogram.Add(batch.begin(), batch.end());
+  CHECK(histogram.Range() == 1.0f);
+  CHECK(histogram.Counts()[2] == 7);
+  CHECK(histogram.Counts()[4] == 8);
+
+  for (Index i = 0; i < 16; ++i) batch[i] = 0.0f;
+  batch[5] = 3.5f;
+  histogram.Add(batch.begin(), batch.end());
+  // Range doubled twice, each time merging pairs of bins.
+  CHECK(histogram.Range() == 4.0f);
+  CHECK(histogram.Total() == 32);
+  const uint64_t expected[8] = {15 + 7, 8 + 1, 0, 0, 0, 0, 0, 1};
+  for (Index i = 0; i < 8; ++i)
+    CHECK(histogram.Counts()[i] == expected[i]);
+}
+
+TEST_CASE("Histogram percentile", "[calibration]") {
+  if (kCPU < CPUType::SSE2) return;
+  AlignedVector<float> batch(1 << 16);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  Histogram histogram;
+  for (int round = 0; round < 4; ++round) {
+    for (auto &it : batch) it = dist(gen);
+    histogram.Add(batch.begin(), batch.end());
+  }
+  CHECK(std::fabs(histogram.Percentile(50) - 0.5f) < 0.01f);
+  CHECK(std::fabs(histogram.Percentile(99) - 0.99f) < 0.01f);
+  CHECK(histogram.Percentile(100) <= histogram.Range());
+}
+
+TEST_CASE("Histogram entropy clips outliers", "[calibration]") {
+  if (kCPU < CPUType::SSE2) return;
+  AlignedVector<float> batch(1 << 18);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.f, 1.f);
+  for (auto &it : batch) it = dist(gen);
+  // A few large outliers dominate MaxAbsolute.
+  batch[10] = 40.f;
+  batch[1000] = -35.f;
+  Histogram histogram;
+  histogram.Add(batch.begin(), batch.end());
+  float threshold = histogram.Entropy();
+  CHECK(threshold > 2.f);
+  CHECK(threshold < 10.f);
+  CHECK(QuantMult(threshold) == 127.f / threshold);
+}
+
+// One outlier far beyond the bulk: when bulk / range < levels / bins, every
+// threshold from levels bins up has an empty last bin holding only outliers.
+TEST_CASE("Histogram entropy with a distant outlier", "[calibration]") {
+  if (kCPU < CPUType::SSE2) return;
+  AlignedVector<float> batch(1 << 18);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.f, 1.f);
+  for (auto &it : batch) it = dist(gen);
+  batch[10] = 100.f;
+  Histogram histogram;
+  histogram.Add(batch.begin(), batch.end());
+  float threshold = histogram.Entropy();
+  CHECK(threshold > 2.f);
+  CHECK(threshold < 10.f);
+}
+
+TEST_CASE("Histogram ignores non-finite values for the range", "[calibration]") {
+  if (kCPU < CPUType::SSE2) return;
+  AlignedVector<float> batch(1024);
+  for (Index i = 0; i < batch.size(); ++i) batch[i] = static_cast<float>(i % 8);
+  batch[5] = std::numeric_limits<float>::infinity();
+  batch[6] = -std::numeric_limits<float>::infinity();
+  batch[7] = std::numeric_limits<float>::quiet_NaN();
+  Histogram histogram;
+  histogram.Add(batch.begin(), batch.end());
+  CHECK(histogram.Range() == 7.f);
+  // Three non-finite values and every 7 but the one at index 7.
+  CHECK(histogram.Counts().back() == 3 + 1024 / 8 - 1);
+  CHECK(histogram.Percentile(50) <= 4.f);
+
+  // A batch that is zero apart from infinity leaves the range unset.
+  Histogram zeros;
+  for (auto &it : batch) it = 0.f;
+  batch[3] = std::numeric_limits<float>::infinity();
+  zeros.Add(batch.begin(), batch.end());
+  CHECK(zeros.Range() == 0.f);
+  CHECK(zeros.Counts()[0] == 1023);
+  CHECK(zeros.Counts().back() == 1);
+}
+
+TEST_CASE("Histogram of zeros", "[calibration]") {
+  if (kCPU < CPUType::SSE2) return;
+  AlignedVector<float> batch(64);
+  for (auto &it : batch) it = 0.f;
+  Histogram histogram;
+  histogram.Add(batch.begin(), batch.end());
+  CHECK(histogram.Counts()[0] == 64);
+  CHECK(QuantMult(histogram.Entropy()) == 1.f);
+  CHECK(QuantMult(histogram.Percentile(99.9)) == 1.f);
+}
+
+} // namespace
+} // namespace intgemm
@@ -0,0 +1,76 @@
+#include "../test.h"
+#include "../../aligned.h"
+#include "../../kernels.h"
+
+#include <numeric>
+
+namespace intgemm {
+
+template <CPUType CPUType_, typename ElemType_>
+void kernel_accumulate_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vec_t = vector_t<CPUType_, ElemType_>;
+  constexpr static auto VECTOR_LENGTH = sizeof(vec_t) / sizeof(ElemType_);
+
+  AlignedVector<ElemType_> input(VECTOR_LENGTH);
+  AlignedVector<ElemType_> output(VECTOR_LENGTH);
+
+  std::iota(input.begin(), input.end(), 0);
+  std::fill(output.begin(), output.end(), 100);
+
+  kernels::accumulate(*input.template as<vec_t>(), output.begin(), 0);
+  for (std::size_t i = 0; i < output.size(); ++i)
+    CHECK(output[i] == ElemType_(100 + i));
+}
+
+template <CPUType CPUType_>
+void kernel_accumulate_beta_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vec_t = vector_t<CPUType_, float>;
+  constexpr static auto VECTOR_LENGTH = sizeof(vec_t) / sizeof(float);
+
+  AlignedVector<float> input(VECTOR_LENGTH);
+  AlignedVector<float> output(VECTOR_LENGTH);
+
+  std::iota(input.begin(), input.end(), 0);
+  std::fill(output.begin(), output.end(), 100);
+
+  kernels::accumulate(*input.template as<vec_t>(), output.begin(), set1_ps<vec_t>(-0.5f), 0);
+  for (std::size_t i = 0; i < output.size(); ++i)
+    CHECK(output[i] == float(i) - 50.f);
+}
+
+template INTGEMM_SSE2 void kernel_accumulate_test<CPUType::SSE2, int>();
+template INTGEMM_SSE2 void kernel_accumulate_test<CPUType::SSE2, float>();
+template INTGEMM_SSE2 void kernel_accumulate_test<CPUType::SSE2, double>();
+template INTGEMM_SSE2 void kernel_accumulate_beta_test<CPUType::SSE2>();
+KERNEL_TEST_CASE("accumulate/int SSE2") { return kernel_accumulate_test<CPUType::SSE2, int>(); }
+KERNEL_TEST_CASE("accumulate/float SSE2") { return kernel_accumulate_test<CPUType::SSE2, float>(); }
+KERNEL_TEST_CASE("accumulate/double SSE2") { return kernel_accumulate_test<CPUType::SSE2, double>(); }
+KERNEL_TEST_CASE("accumulate/float beta SSE2") { return kernel_accumulate_beta_test<CPUType::SSE2>(); }
+
+template INTGEMM_AVX2 void kernel_accumulate_test<CPUType::AVX2, int>();
+template INTGEMM_AVX2 void kernel_accumulate_test<CPUType::AVX2, float>();
+template INTGEMM_AVX2 void kernel_accumulate_test<CPUType::AVX2, double>();
+template INTGEMM_AVX2 void kernel_accumulate_beta_test<CPUType::AVX2>();
+KERNEL_TEST_CASE("accumulate/int AVX2") { return kernel_accumulate_test<CPUType::AVX2, int>(); }
+KERNEL_TEST_CASE("accumulate/float AVX2") { return kernel_accumulate_test<CPUType::AVX2, float>(); }
+KERNEL_TEST_CASE("accumulate/double AVX2") { return kernel_accumulate_test<CPUType::AVX2, double>(); }
+KERNEL_TEST_CASE("accumulate/float beta AVX2") { return kernel_accumulate_beta_test<CPUType::AVX2>(); }
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+template INTGEMM_AVX512BW void kernel_accumulate_test<CPUType::AVX512BW, int>();
+template INTGEMM_AVX512BW void kernel_accumulate_test<CPUType::AVX512BW, float>();
+template INTGEMM_AVX512BW void kernel_accumulate_test<CPUType::AVX512BW, double>();
+template INTGEMM_AVX512BW void kernel_accumulate_beta_test<CPUType::AVX512BW>();
+KERNEL_TEST_CASE("accumulate/int AVX512BW") { return kernel_accumulate_test<CPUType::AVX512BW, int>(); }
+KERNEL_TEST_CASE("accumulate/float AVX512BW") { return kernel_accumulate_test<CPUType::AVX512BW, float>(); }
+KERNEL_TEST_CASE("accumulate/double AVX512BW") { return kernel_accumulate_test<CPUType::AVX512BW, double>(); }
+KERNEL_TEST_CASE("accumulate/float beta AVX512BW") { return kernel_accumulate_beta_test<CPUType::AVX512BW>(); }
+#endif
+
+}
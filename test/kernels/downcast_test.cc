@@ -2,6 +2,7 @@
 #include "../../aligned.h"
 #include "../../kernels.h"
 
+#include <algorithm>
 #include <numeric>
 
 namespace intgemm {
@@ -37,6 +38,40 @@ template INTGEMM_AVX512BW void kernel_downcast32to8_test<CPUType::AVX512BW>();
 KERNEL_TEST_CASE("downcast32to8 AVX512BW") { return kernel_downcast32to8_test<CPUType::AVX512BW>(); }
 #endif
 
+template <CPUType CPUType_>
+void kernel_downcast32to8u_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vi = vector_t<CPUType_, int>;
+  const int LENGTH = sizeof(vi) / sizeof(uint8_t);
+
+  AlignedVector<int32_t> input(LENGTH);
+  AlignedVector<uint8_t> output(LENGTH);
+
+  // Cover both saturation ends.
+  std::iota(input.begin(), input.end(), -LENGTH / 2);
+  for (std::size_t i = 0; i < input.size(); ++i)
+    input[i] *= 5;
+
+  *output.template as<vi>() = kernels::downcast32to8u(
+    input.template as<vi>()[0], input.template as<vi>()[1],
+    input.template as<vi>()[2], input.template as<vi>()[3]);
+  for (std::size_t i = 0; i < output.size(); ++i)
+    CHECK(output[i] == uint8_t(std::min(255, std::max(0, input[i]))));
+}
+
+template INTGEMM_SSE2 void kernel_downcast32to8u_test<CPUType::SSE2>();
+KERNEL_TEST_CASE("downcast32to8u SSE2") { return kernel_downcast32to8u_test<CPUType::SSE2>(); }
+
+template INTGEMM_AVX2 void kernel_downcast32to8u_test<CPUType::AVX2>();
+KERNEL_TEST_CASE("downcast32to8u AVX2") { return kernel_downcast32to8u_test<CPUType::AVX2>(); }
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+template INTGEMM_AVX512BW void kernel_downcast32to8u_test<CPUType::AVX512BW>();
+KERNEL_TEST_CASE("downcast32to8u AVX512BW") { return kernel_downcast32to8u_test<CPUType::AVX512BW>(); }
+#endif
+
 template <CPUType CPUType_>
 void kernel_downcast32to16_test() {
   if (kCPU < CPUType_)
@@ -0,0 +1,140 @@
+#include "../test.h"
+#include "../../aligned.h"
+#include "../../kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace intgemm {
+
+static int32_t requantize_reference(int32_t input, FixedPointScale scale) {
+  int64_t magnitude = std::llabs(int64_t(input));
+  int64_t result = (magnitude * scale.multiplier + (int64_t(1) << (scale.right_shift - 1))) >> scale.right_shift;
+  result = std::min<int64_t>(result, std::numeric_limits<int32_t>::max());
+  return static_cast<int32_t>(input < 0 ? -result : result);
+}
+
+template <CPUType CPUType_>
+void kernel_requantize_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vi = vector_t<CPUType_, int>;
+  const int LENGTH = sizeof(vi) / sizeof(int);
+
+  std::mt19937 gen;
+  std::uniform_int_distribution<int32_t> dist(std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+  AlignedVector<int32_t> input(LENGTH * 64);
+  for (auto& it : input) {
+    it = dist(gen) >> (gen() % 31);
+  }
+  input[0] = std::numeric_limits<int32_t>::min();
+  input[1] = std::numeric_limits<int32_t>::max();
+  input[2] = 0;
+  input[3] = -1;
+  input[4] = 2000000000;
+  input[5] = 10;
+  input[6] = -2000000000;
+  input[7] = -10;
+
+  for (float scale : {0.5f, 1.5f, 4.f, 1e9f, 0.01f, 3.7e-5f, 1e-7f}) {
+    FixedPointScale fixed = ToFixedPoint(scale);
+    auto multiplier = set1_epi32<vi>(fixed.multiplier);
+    auto rounding = set1_epi64<vi>(int64_t(1) << (fixed.right_shift - 1));
+    auto right_shift = _mm_cvtsi32_si128(fixed.right_shift);
+
+    AlignedVector<int32_t> output(input.size());
+    // Copy through memcpy: vector_t drops the may_alias attribute of the intrinsic types.
+    for (std::size_t i = 0; i < input.size(); i += LENGTH) {
+      vi in, out;
+      std::memcpy(&in, input.begin() + i, sizeof(vi));
+      out = kernels::requantize(in, multiplier, rounding, right_shift);
+      std::memcpy(output.begin() + i, &out, sizeof(vi));
+    }
+    for (std::size_t i = 0; i < output.size(); ++i) {
+      INFO("scale " << scale << " input " << input[i]);
+      CHECK(output[i] == requantize_reference(input[i], fixed));
+    }
+  }
+}
+
+template <CPUType CPUType_>
+void kernel_write_saturated_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vi = vector_t<CPUType_, int>;
+  const int LENGTH = sizeof(vi) / sizeof(int);
+
+  AlignedVector<int32_t> input(LENGTH);
+  AlignedVector<int8_t> output(LENGTH + 1);
+  for (int i = 0; i < LENGTH; ++i)
+    input[i] = (i - LENGTH / 2) * 23;
+  input[0] = std::numeric_limits<int32_t>::min();
+  input[LENGTH - 1] = 100000;
+  output[LENGTH] = 42;
+
+  vi in;
+  std::memcpy(&in, input.begin(), sizeof(vi));
+  kernels::write_saturated(in, output.begin(), 0);
+  for (int i = 0; i < LENGTH; ++i)
+    CHECK(output[i] == std::max(-127, std::min(127, input[i])));
+  // Nothing past the converted elements is touched.
+  CHECK(output[LENGTH] == 42);
+}
+
+// Scales of 1 or more overflow int32 for large inputs; the result saturates
+// instead of wrapping into the other lane or the sign, as RequantizeAndWrite uses it.
+template <CPUType CPUType_>
+void kernel_requantize_large_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vi = vector_t<CPUType_, int>;
+  const int LENGTH = sizeof(vi) / sizeof(int);
+
+  AlignedVector<int32_t> input(LENGTH);
+  for (int i = 0; i < LENGTH; ++i)
+    input[i] = (i % 2) ? 10 : ((i % 4) ? -2000000000 : 2000000000);
+  for (float scale : {1.5f, 4.f}) {
+    INFO("scale " << scale);
+    FixedPointScale fixed = ToFixedPoint(scale);
+    vi in;
+    std::memcpy(&in, input.begin(), sizeof(vi));
+    vi out = kernels::requantize(in, set1_epi32<vi>(fixed.multiplier), set1_epi64<vi>(int64_t(1) << (fixed.right_shift - 1)), _mm_cvtsi32_si128(fixed.right_shift));
+    AlignedVector<int8_t> output(LENGTH);
+    kernels::write_saturated(out, output.begin(), 0);
+    for (int i = 0; i < LENGTH; ++i) {
+      int expected = (i % 2) ? int(10 * scale) : (input[i] > 0 ? 127 : -127);
+      CHECK(int(output[i]) == expected);
+    }
+  }
+}
+
+template INTGEMM_SSE2 void kernel_requantize_test<CPUType::SSE2>();
+template INTGEMM_SSE2 void kernel_write_saturated_test<CPUType::SSE2>();
+template INTGEMM_SSE2 void kernel_requantize_large_test<CPUType::SSE2>();
+KERNEL_TEST_CASE("requantize SSE2") { return kernel_requantize_test<CPUType::SSE2>(); }
+KERNEL_TEST_CASE("requantize large SSE2") { return kernel_requantize_large_test<CPUType::SSE2>(); }
+KERNEL_TEST_CASE("write_saturated SSE2") { return kernel_write_saturated_test<CPUType::SSE2>(); }
+
+template INTGEMM_AVX2 void kernel_requantize_test<CPUType::AVX2>();
+template INTGEMM_AVX2 void kernel_write_saturated_test<CPUType::AVX2>();
+template INTGEMM_AVX2 void kernel_requantize_large_test<CPUType::AVX2>();
+KERNEL_TEST_CASE("requantize AVX2") { return kernel_requantize_test<CPUType::AVX2>(); }
+KERNEL_TEST_CASE("requantize large AVX2") { return kernel_requantize_large_test<CPUType::AVX2>(); }
+KERNEL_TEST_CASE("write_saturated AVX2") { return kernel_write_saturated_test<CPUType::AVX2>(); }
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+template INTGEMM_AVX512BW void kernel_requantize_test<CPUType::AVX512BW>();
+template INTGEMM_AVX512BW void kernel_write_saturated_test<CPUType::AVX512BW>();
+template INTGEMM_AVX512BW void kernel_requantize_large_test<CPUType::AVX512BW>();
+KERNEL_TEST_CASE("requantize AVX512BW") { return kernel_requantize_test<CPUType::AVX512BW>(); }
+KERNEL_TEST_CASE("requantize large AVX512BW") { return kernel_requantize_large_test<CPUType::AVX512BW>(); }
+KERNEL_TEST_CASE("write_saturated AVX512BW") { return kernel_write_saturated_test<CPUType::AVX512BW>(); }
+#endif
+
+}
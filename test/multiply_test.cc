@@ -4,6 +4,7 @@
 #include "../intgemm.h"
 #include "../multiply.h"
 #include "../callbacks.h"
+#include "../calibration.h"
 
 #include <algorithm>
 #include <cassert>
@@ -15,6 +16,7 @@
 #include <iostream>
 #include <memory>
 #include <random>
+#include <vector>
 
 namespace intgemm {
 
@@ -36,6 +38,38 @@ INTGEMM_SSE2 TEST_CASE("Transpose 16", "[transpose]") {
   }
 }
 
+template <class Register> void TestTranspose32() {
+  const unsigned N = sizeof(Register) / sizeof(int32_t);
+  AlignedVector<int32_t> input(N * N);
+  std::iota(input.begin(), input.end(), 0);
+
+  AlignedVector<int32_t> ref(N * N);
+  references::Transpose(input.begin(), ref.begin(), N, N);
+
+  // Overwrite input.
+  Transpose32(*reinterpret_cast<Register (*)[N]>(input.begin()));
+
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    CHECK_MESSAGE(ref[i] == input[i], "32-bit transpose failure at: " << i << ": " << ref[i] << " != " << input[i]);
+  }
+}
+
+template INTGEMM_SSE2 void TestTranspose32<__m128i>();
+template INTGEMM_AVX2 void TestTranspose32<__m256i>();
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+template INTGEMM_AVX512BW void TestTranspose32<__m512i>();
+#endif
+
+TEST_CASE("Transpose 32", "[transpose]") {
+  TestTranspose32<__m128i>();
+  if (kCPU < CPUType::AVX2) return;
+  TestTranspose32<__m256i>();
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestTranspose32<__m512i>();
+#endif
+}
+
 INTGEMM_SSSE3 TEST_CASE("Transpose 8", "[transpose]") {
   if (kCPU < CPUType::SSSE3) return;
   const unsigned N = 16;
@@ -228,6 +262,25 @@ TEST_CASE("MaxAbsolute AVX512F", "[max]") {
   #endif
 }
 
+// Large enough to be split across threads; the maximum lands in different chunks.
+TEST_CASE("MaxAbsolute parallel", "[max]") {
+  if (kCPU < CPUType::SSE2) return;
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-8.0, 8.0);
+  const std::size_t kLength = (1 << 20) + 48;
+  AlignedVector<float> test(kLength);
+  for (auto& it : test) {
+    it = dist(gen);
+  }
+  for (std::size_t position : {std::size_t(0), std::size_t(65535), std::size_t(65536), std::size_t(500000), kLength - 1}) {
+    float saved = test[position];
+    test[position] = -32.0;
+    CHECK(MaxAbsolute(test.begin(), test.end()) == 32.0f);
+    test[position] = saved;
+  }
+  CompareMaxAbs(test.begin(), test.end(), MaxAbsolute(test.begin(), test.end()));
+}
+
 // Based on https://arxiv.org/abs/1705.01991
 
 // Copyright (c) 2017 Microsoft Corporation
@@ -354,6 +407,612 @@ template <class Routine> void TestMultiplyBias(Index A_rows, Index width, Index
    int_tolerance, float_tolerance, MSE_float_tolerance, MSE_int_tolerance);
 }
 
+template <class Routine> void TestMultiplyAccumulate(Index A_rows, Index width, Index B_cols, float beta) {
+  typedef typename Routine::Integer Integer;
+  std::ostringstream info;
+  info << Routine::kName << "\t" << A_rows << '\t' << width << '\t' << B_cols << '\t' << beta << '\n';
+
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  AlignedVector<float> bias(B_cols);
+  AlignedVector<float> test_C(A_rows * B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+  for (auto& it : bias) {
+    it = dist(gen);
+  }
+  for (auto& it : test_C) {
+    it = dist(gen);
+  }
+  AlignedVector<float> original_C(test_C.size());
+  std::copy(test_C.begin(), test_C.end(), original_C.begin());
+
+  float quant_mult = (sizeof(Integer) == 2) ? 1024 : 64;
+  float unquant_mult = 1.0/(quant_mult*quant_mult);
+
+  AlignedVector<Integer> A_prep(A.size());
+  AlignedVector<Integer> B_prep(B.size());
+  Routine::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+  Routine::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndAccumulate(unquant_mult, bias.begin(), test_C.begin(), beta));
+
+  // Compare against the overwriting callback so saturation in the 8-bit backends cancels out.
+  AlignedVector<float> ref_C(test_C.size());
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), ref_C.begin()));
+  for (Index i = 0; i < ref_C.size(); ++i) {
+    ref_C[i] += beta * original_C[i];
+  }
+
+  INFO(info.str());
+  CompareEps(ref_C.begin(), test_C.begin(), test_C.size(), 1e-5f);
+}
+
+TEST_CASE ("Multiply accumulate", "[multiply]") {
+  TestMultiplyAccumulate<SSE2_16bit>(8, 256, 256, 1.f);
+  TestMultiplyAccumulate<SSE2_16bit>(200, 256, 256, 0.5f);
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyAccumulate<SSSE3_8bit>(8, 256, 256, 1.f);
+  TestMultiplyAccumulate<SSSE3_8bit>(200, 256, 256, 0.5f);
+  if (kCPU < CPUType::AVX2) return;
+  TestMultiplyAccumulate<AVX2_8bit>(8, 256, 256, 1.f);
+  TestMultiplyAccumulate<AVX2_8bit>(200, 256, 256, 0.5f);
+  TestMultiplyAccumulate<AVX2_16bit>(8, 256, 256, 1.f);
+  TestMultiplyAccumulate<AVX2_16bit>(200, 256, 256, 0.5f);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestMultiplyAccumulate<AVX512_8bit>(8, 256, 256, 1.f);
+  TestMultiplyAccumulate<AVX512_8bit>(200, 256, 256, 0.5f);
+  TestMultiplyAccumulate<AVX512_16bit>(8, 256, 256, 1.f);
+  TestMultiplyAccumulate<AVX512_16bit>(200, 256, 256, 0.5f);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+  if (kCPU < CPUType::AVX512VNNI) return;
+  TestMultiplyAccumulate<AVX512VNNI_8bit>(8, 256, 256, 1.f);
+  TestMultiplyAccumulate<AVX512VNNI_8bit>(200, 256, 256, 0.5f);
+#endif
+}
+
+template <class Routine> void TestMultiplyTransposed(Index A_rows, Index width, Index B_cols) {
+  typedef typename Routine::Integer Integer;
+  std::ostringstream info;
+  info << Routine::kName << "\t" << A_rows << '\t' << width << '\t' << B_cols << '\n';
+
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+
+  float quant_mult = (sizeof(Integer) == 2) ? 1024 : 64;
+  float unquant_mult = 1.0/(quant_mult*quant_mult);
+
+  AlignedVector<Integer> A_prep(A.size());
+  AlignedVector<Integer> B_prep(B.size());
+  Routine::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+  Routine::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+
+  AlignedVector<float> C(A_rows * B_cols);
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, C.begin()));
+  AlignedVector<float> C_transposed(C.size());
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWriteTransposed(unquant_mult, C_transposed.begin()));
+  AlignedVector<int> C_int(C.size());
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::Write<int>(C_int.begin()));
+  AlignedVector<int> C_int_transposed(C.size());
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::WriteTransposed<int>(C_int_transposed.begin()));
+
+  AlignedVector<float> ref(C.size());
+  references::Transpose(C.begin(), ref.begin(), A_rows, B_cols);
+  AlignedVector<int> ref_int(C.size());
+  references::Transpose(C_int.begin(), ref_int.begin(), A_rows, B_cols);
+
+  INFO(info.str());
+  Compare(ref.begin(), C_transposed.begin(), C.size());
+  Compare(ref_int.begin(), C_int_transposed.begin(), C.size());
+}
+
+TEST_CASE ("Multiply transposed", "[multiply]") {
+  TestMultiplyTransposed<SSE2_16bit>(8, 256, 256);
+  TestMultiplyTransposed<SSE2_16bit>(19, 256, 64);
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyTransposed<SSSE3_8bit>(8, 256, 256);
+  TestMultiplyTransposed<SSSE3_8bit>(19, 256, 64);
+  if (kCPU < CPUType::AVX2) return;
+  TestMultiplyTransposed<AVX2_8bit>(8, 256, 256);
+  TestMultiplyTransposed<AVX2_8bit>(19, 256, 64);
+  TestMultiplyTransposed<AVX2_16bit>(8, 256, 256);
+  TestMultiplyTransposed<AVX2_16bit>(19, 256, 64);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestMultiplyTransposed<AVX512_8bit>(8, 256, 256);
+  TestMultiplyTransposed<AVX512_8bit>(35, 256, 64);
+  TestMultiplyTransposed<AVX512_8bit>(35, 256, 24);
+  TestMultiplyTransposed<AVX512_16bit>(8, 256, 256);
+  TestMultiplyTransposed<AVX512_16bit>(35, 256, 64);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+  if (kCPU < CPUType::AVX512VNNI) return;
+  TestMultiplyTransposed<AVX512VNNI_8bit>(8, 256, 256);
+  TestMultiplyTransposed<AVX512VNNI_8bit>(35, 256, 64);
+#endif
+}
+
+template <class Routine> void TestMultiplyRequantize(Index A_rows, Index width, Index B_cols) {
+  typedef typename Routine::Integer Integer;
+  std::ostringstream info;
+  info << Routine::kName << "\t" << A_rows << '\t' << width << '\t' << B_cols << '\n';
+
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  AlignedVector<int> bias(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+  for (auto& it : bias) {
+    it = static_cast<int>(dist(gen) * 1000);
+  }
+
+  float quant_mult = (sizeof(Integer) == 2) ? 1024 : 64;
+  AlignedVector<Integer> A_prep(A.size());
+  AlignedVector<Integer> B_prep(B.size());
+  Routine::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+  Routine::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+
+  AlignedVector<int> C_int(A_rows * B_cols);
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::AddBiasAndWrite(bias.begin(), C_int.begin()));
+
+  // Map roughly the expected range of the products onto int8.
+  FixedPointScale scale = ToFixedPoint(127.f / (quant_mult * quant_mult * 8.f));
+  AlignedVector<int8_t> test_C(C_int.size());
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::AddBiasAndRequantizeAndWrite(bias.begin(), scale, test_C.begin()));
+
+  INFO(info.str());
+  for (Index i = 0; i < C_int.size(); ++i) {
+    int64_t magnitude = std::llabs(int64_t(C_int[i]));
+    int64_t scaled = (magnitude * scale.multiplier + (int64_t(1) << (scale.right_shift - 1))) >> scale.right_shift;
+    int64_t expected = std::max<int64_t>(-127, std::min<int64_t>(127, C_int[i] < 0 ? -scaled : scaled));
+    CHECK(int64_t(test_C[i]) == expected);
+  }
+}
+
+TEST_CASE ("Multiply requantize", "[multiply]") {
+  TestMultiplyRequantize<SSE2_16bit>(8, 256, 256);
+  TestMultiplyRequantize<SSE2_16bit>(19, 256, 64);
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyRequantize<SSSE3_8bit>(8, 256, 256);
+  TestMultiplyRequantize<SSSE3_8bit>(19, 256, 64);
+  if (kCPU < CPUType::AVX2) return;
+  TestMultiplyRequantize<AVX2_8bit>(8, 256, 256);
+  TestMultiplyRequantize<AVX2_8bit>(19, 256, 64);
+  TestMultiplyRequantize<AVX2_16bit>(8, 256, 256);
+  TestMultiplyRequantize<AVX2_16bit>(19, 256, 64);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestMultiplyRequantize<AVX512_8bit>(8, 256, 256);
+  TestMultiplyRequantize<AVX512_8bit>(35, 256, 64);
+  TestMultiplyRequantize<AVX512_8bit>(35, 256, 24);
+  TestMultiplyRequantize<AVX512_16bit>(8, 256, 256);
+  TestMultiplyRequantize<AVX512_16bit>(35, 256, 64);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+  if (kCPU < CPUType::AVX512VNNI) return;
+  TestMultiplyRequantize<AVX512VNNI_8bit>(8, 256, 256);
+  TestMultiplyRequantize<AVX512VNNI_8bit>(35, 256, 64);
+#endif
+}
+
+template <class Routine> void TestMultiplyGrouped(Index A_rows, Index width, Index B_cols, Index group_size) {
+  std::ostringstream info;
+  info << Routine::kName << "\t" << A_rows << '\t' << width << '\t' << B_cols << '\t' << group_size << '\n';
+
+  // Integer-valued inputs quantize exactly with a multiplier of 1.
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  std::mt19937 gen;
+  std::uniform_int_distribution<int> dist(-20, 20);
+  for (auto& it : A) {
+    it = static_cast<float>(dist(gen));
+  }
+  for (auto& it : B) {
+    it = static_cast<float>(dist(gen));
+  }
+  const Index groups = width / group_size;
+  std::uniform_real_distribution<float> scale_dist(0.01f, 1.0f);
+  std::vector<float> A_scales(A_rows * groups), B_scales(groups * B_cols);
+  for (auto& it : A_scales) {
+    it = scale_dist(gen);
+  }
+  for (auto& it : B_scales) {
+    it = scale_dist(gen);
+  }
+
+  AlignedVector<int8_t> A_prep(A.size());
+  AlignedVector<int8_t> B_prep(B.size());
+  Routine::PrepareA(A.begin(), A_prep.begin(), 1.0f, A_rows, width);
+  Routine::PrepareB(B.begin(), B_prep.begin(), 1.0f, width, B_cols);
+
+  AlignedVector<float> test_C(A_rows * B_cols);
+  Routine::MultiplyGrouped(A_prep.begin(), B_prep.begin(), A_scales.data(), B_scales.data(), group_size, A_rows, width, B_cols, callbacks::Write<float>(test_C.begin()));
+  AlignedVector<float> unscaled_C(A_rows * B_cols);
+  Routine::MultiplyGrouped(A_prep.begin(), B_prep.begin(), nullptr, B_scales.data(), group_size, A_rows, width, B_cols, callbacks::Write<float>(unscaled_C.begin()));
+
+  INFO(info.str());
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < B_cols; ++c) {
+      double expected = 0.0, expected_unscaled = 0.0;
+      for (Index g = 0; g < groups; ++g) {
+        double sum = 0.0;
+        for (Index k = g * group_size; k < (g + 1) * group_size; ++k) {
+          sum += double(A[r * width + k]) * double(B[k * B_cols + c]);
+        }
+        expected += sum * A_scales[r * groups + g] * B_scales[g * B_cols + c];
+        expected_unscaled += sum * B_scales[g * B_cols + c];
+      }
+      CHECK(test_C[r * B_cols + c] == Approx(expected).epsilon(1e-5).margin(1e-3));
+      CHECK(unscaled_C[r * B_cols + c] == Approx(expected_unscaled).epsilon(1e-5).margin(1e-3));
+    }
+  }
+}
+
+TEST_CASE ("Multiply grouped", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyGrouped<SSSE3_8bit>(8, 256, 16, 64);
+  TestMultiplyGrouped<SSSE3_8bit>(19, 256, 24, 128);
+  if (kCPU < CPUType::AVX2) return;
+  TestMultiplyGrouped<AVX2_8bit>(8, 256, 16, 64);
+  TestMultiplyGrouped<AVX2_8bit>(19, 256, 24, 128);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestMultiplyGrouped<AVX512_8bit>(8, 256, 16, 64);
+  TestMultiplyGrouped<AVX512_8bit>(35, 256, 24, 128);
+  TestMultiplyGrouped<AVX512_8bit>(35, 512, 64, 256);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+  if (kCPU < CPUType::AVX512VNNI) return;
+  TestMultiplyGrouped<AVX512VNNI_8bit>(8, 256, 16, 64);
+  TestMultiplyGrouped<AVX512VNNI_8bit>(35, 256, 24, 128);
+#endif
+}
+
+TEST_CASE ("Int8 grouped quantization", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 16, width = 512, B_cols = 32, group_size = 64;
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+  // A few outlier features in A and one large group in B.
+  for (Index r = 0; r < A_rows; ++r) {
+    A[r * width + 3] *= 60.0f;
+  }
+  for (Index k = 128; k < 192; ++k) {
+    for (Index c = 0; c < B_cols; ++c) {
+      B[k * B_cols + c] *= 30.0f;
+    }
+  }
+
+  std::vector<double> reference(A_rows * B_cols, 0.0);
+  for (Index r = 0; r < A_rows; ++r)
+    for (Index k = 0; k < width; ++k)
+      for (Index c = 0; c < B_cols; ++c)
+        reference[r * B_cols + c] += double(A[r * width + k]) * double(B[k * B_cols + c]);
+
+  // Per-tensor quantization.
+  float A_mult = 127.0f / MaxAbsolute(A.begin(), A.end());
+  float B_mult = 127.0f / MaxAbsolute(B.begin(), B.end());
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), A_mult, A_rows, width);
+  Int8::PrepareB(B.begin(), B_prep.begin(), B_mult, width, B_cols);
+  AlignedVector<float> tensor_C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / (A_mult * B_mult), tensor_C.begin()));
+
+  // Group-wise quantization.
+  std::vector<float> A_scales(A_rows * width / group_size), B_scales(width / group_size * B_cols);
+  Int8::PrepareAGrouped(A.begin(), A_prep.begin(), A_scales.data(), group_size, A_rows, width);
+  Int8::PrepareBGrouped(B.begin(), B_prep.begin(), B_scales.data(), group_size, width, B_cols);
+  AlignedVector<float> grouped_C(A_rows * B_cols);
+  Int8::MultiplyGrouped(A_prep.begin(), B_prep.begin(), A_scales.data(), B_scales.data(), group_size, A_rows, width, B_cols, callbacks::Write<float>(grouped_C.begin()));
+
+  double tensor_error = 0.0, grouped_error = 0.0;
+  for (Index i = 0; i < reference.size(); ++i) {
+    tensor_error += std::fabs(tensor_C[i] - reference[i]);
+    grouped_error += std::fabs(grouped_C[i] - reference[i]);
+  }
+  CHECK(grouped_error < tensor_error / 2);
+}
+
+template <class Routine> void TestMultiplyOutliers(Index A_rows, Index width, Index B_cols) {
+  std::ostringstream info;
+  info << Routine::kName << "\t" << A_rows << '\t' << width << '\t' << B_cols << '\n';
+
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  AlignedVector<float> bias(B_cols);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen) * 0.1f;
+  }
+  for (auto& it : bias) {
+    it = dist(gen);
+  }
+  // Outlier features.
+  const Index planted[] = {5, 70, 71};
+  for (Index r = 0; r < A_rows; r += 3) {
+    for (Index c : planted) {
+      A[r * width + c] = 100.0f * dist(gen);
+    }
+  }
+
+  std::vector<Index> outliers(width);
+  float inlier_max;
+  Index count = Int8::SelectOutliers(A.begin(), A_rows, width, 6.0f, outliers.data(), &inlier_max);
+  REQUIRE(count == 3);
+  CHECK(outliers[0] == 5);
+  CHECK(outliers[1] == 70);
+  CHECK(outliers[2] == 71);
+  CHECK(inlier_max <= 6.0f);
+
+  float A_mult = 127.0f / inlier_max;
+  float B_mult = 127.0f / MaxAbsolute(B.begin(), B.end());
+  AlignedVector<int8_t> A_prep(A.size());
+  AlignedVector<int8_t> B_prep(B.size());
+  std::vector<float> outlier_values(A_rows * count);
+  Int8::PrepareAOutliers(A.begin(), A_prep.begin(), A_mult, A_rows, width, outliers.data(), count, outlier_values.data());
+  Routine::PrepareB(B.begin(), B_prep.begin(), B_mult, width, B_cols);
+
+  AlignedVector<float> test_C(A_rows * B_cols);
+  std::vector<float> outlier_B(count * B_cols);
+  Int8::PrepareBOutliers(B.begin(), B_cols, outliers.data(), count, outlier_B.data());
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddOutliersAndBiasAndWrite(1.0f / (A_mult * B_mult), outlier_values.data(), count, outlier_B.data(), bias.begin(), test_C.begin()));
+
+  // The inlier part through the int8 reference, the outliers exactly.
+  AlignedVector<int8_t> A_quant(A.size());
+  AlignedVector<int8_t> B_quant(B.size());
+  Int8::Quantize(A.begin(), A_quant.begin(), A_mult, static_cast<Index>(A.size()));
+  Int8::Quantize(B.begin(), B_quant.begin(), B_mult, static_cast<Index>(B.size()));
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index j = 0; j < count; ++j) {
+      A_quant[r * width + outliers[j]] = 0;
+    }
+  }
+  INFO(info.str());
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < B_cols; ++c) {
+      int32_t sum = 0;
+      double outlier_sum = 0.0;
+      for (Index k = 0; k < width; ++k) {
+        sum += int32_t(A_quant[r * width + k]) * int32_t(B_quant[k * B_cols + c]);
+      }
+      for (Index c_out : planted) {
+        outlier_sum += double(A[r * width + c_out]) * double(B[c_out * B_cols + c]);
+      }
+      double expected = sum / (A_mult * B_mult) + outlier_sum + bias[c];
+      CHECK(test_C[r * B_cols + c] == Approx(expected).epsilon(1e-4).margin(1e-3));
+    }
+  }
+}
+
+TEST_CASE ("Multiply outliers", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyOutliers<SSSE3_8bit>(8, 256, 16);
+  TestMultiplyOutliers<SSSE3_8bit>(19, 256, 24);
+  if (kCPU < CPUType::AVX2) return;
+  TestMultiplyOutliers<AVX2_8bit>(8, 256, 16);
+  TestMultiplyOutliers<AVX2_8bit>(19, 256, 24);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestMultiplyOutliers<AVX512_8bit>(8, 256, 16);
+  TestMultiplyOutliers<AVX512_8bit>(35, 512, 64);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+  if (kCPU < CPUType::AVX512VNNI) return;
+  TestMultiplyOutliers<AVX512VNNI_8bit>(8, 256, 16);
+  TestMultiplyOutliers<AVX512VNNI_8bit>(35, 512, 64);
+#endif
+}
+
+TEST_CASE ("Int8 smoothing", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 32, width = 256, B_cols = 32;
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+  // Outlier channels in every row of A.
+  for (Index r = 0; r < A_rows; ++r) {
+    A[r * width + 7] *= 50.0f;
+    A[r * width + 100] *= 30.0f;
+  }
+
+  std::vector<double> reference(A_rows * B_cols, 0.0);
+  for (Index r = 0; r < A_rows; ++r)
+    for (Index k = 0; k < width; ++k)
+      for (Index c = 0; c < B_cols; ++c)
+        reference[r * B_cols + c] += double(A[r * width + k]) * double(B[k * B_cols + c]);
+
+  float A_mult = 127.0f / MaxAbsolute(A.begin(), A.end());
+  float B_mult = 127.0f / MaxAbsolute(B.begin(), B.end());
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), A_mult, A_rows, width);
+  Int8::PrepareB(B.begin(), B_prep.begin(), B_mult, width, B_cols);
+  AlignedVector<float> plain_C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / (A_mult * B_mult), plain_C.begin()));
+
+  std::vector<float> activation_max(width), weight_max(width), smooth(width), inverse_smooth(width);
+  ColumnMaxAbsolute(A.begin(), A_rows, width, width, activation_max.data());
+  RowMaxAbsolute(B.begin(), width, B_cols, B_cols, weight_max.data());
+  SmoothingScales(activation_max.data(), weight_max.data(), width, 0.5f, smooth.data(), inverse_smooth.data());
+  float smooth_A_max = 0.0f, smooth_B_max = 0.0f;
+  for (Index k = 0; k < width; ++k) {
+    smooth_A_max = std::max(smooth_A_max, activation_max[k] * inverse_smooth[k]);
+    smooth_B_max = std::max(smooth_B_max, weight_max[k] * smooth[k]);
+  }
+  A_mult = 127.0f / smooth_A_max;
+  B_mult = 127.0f / smooth_B_max;
+  Int8::PrepareASmooth(A.begin(), A_prep.begin(), A_mult, inverse_smooth.data(), A_rows, width);
+  Int8::PrepareBSmooth(B.begin(), B_prep.begin(), B_mult, smooth.data(), width, B_cols);
+  AlignedVector<float> smooth_C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / (A_mult * B_mult), smooth_C.begin()));
+
+  double plain_error = 0.0, smooth_error = 0.0;
+  for (Index i = 0; i < reference.size(); ++i) {
+    plain_error += std::fabs(plain_C[i] - reference[i]);
+    smooth_error += std::fabs(smooth_C[i] - reference[i]);
+  }
+  CHECK(smooth_error < plain_error / 2);
+}
+
+TEST_CASE ("Int8 Hadamard rotation", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 32, width = 512, B_cols = 32, block = 128;
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+  for (Index r = 0; r < A_rows; ++r) {
+    A[r * width + 7] *= 50.0f;
+    A[r * width + 300] *= 30.0f;
+  }
+
+  std::vector<double> reference(A_rows * B_cols, 0.0);
+  for (Index r = 0; r < A_rows; ++r)
+    for (Index k = 0; k < width; ++k)
+      for (Index c = 0; c < B_cols; ++c)
+        reference[r * B_cols + c] += double(A[r * width + k]) * double(B[k * B_cols + c]);
+
+  float A_mult = 127.0f / MaxAbsolute(A.begin(), A.end());
+  float B_mult = 127.0f / MaxAbsolute(B.begin(), B.end());
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), A_mult, A_rows, width);
+  Int8::PrepareB(B.begin(), B_prep.begin(), B_mult, width, B_cols);
+  AlignedVector<float> plain_C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / (A_mult * B_mult), plain_C.begin()));
+
+  std::vector<float> signs(width);
+  HadamardSigns(1, width, signs.data());
+  // quant_mult of the rotated A from a rotated float copy, as calibration would.
+  AlignedVector<float> rotated(A.size());
+  std::copy(A.begin(), A.end(), rotated.begin());
+  RotateHadamard(rotated.begin(), signs.data(), block, A_rows, width);
+  A_mult = 127.0f / MaxAbsolute(rotated.begin(), rotated.end());
+  B_mult = 64.0f / MaxAbsolute(B.begin(), B.end());
+  Int8::PrepareAHadamard(A.begin(), A_prep.begin(), A_mult, signs.data(), block, A_rows, width);
+  Int8::PrepareBHadamard(B.begin(), B_prep.begin(), B_mult, signs.data(), block, width, B_cols);
+  AlignedVector<float> rotated_C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / (A_mult * B_mult), rotated_C.begin()));
+
+  double plain_error = 0.0, rotated_error = 0.0;
+  for (Index i = 0; i < reference.size(); ++i) {
+    plain_error += std::fabs(plain_C[i] - reference[i]);
+    rotated_error += std::fabs(rotated_C[i] - reference[i]);
+  }
+  CHECK(rotated_error < plain_error / 2);
+}
+
+TEST_CASE ("Int8 norm per row", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 32, width = 256, B_cols = 32;
+  const float epsilon = 1e-5f;
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  std::vector<float> gamma(width), beta(width), bias(B_cols);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  for (auto& it : A) {
+    it = dist(gen);
+  }
+  for (auto& it : B) {
+    it = dist(gen);
+  }
+  for (auto& it : gamma) {
+    it = 1.0f + 0.1f * dist(gen);
+  }
+  for (auto& it : beta) {
+    it = 0.1f * dist(gen);
+  }
+  for (auto& it : bias) {
+    it = dist(gen);
+  }
+  // Some rows have an outlier, so their normalized range is much wider.
+  for (Index r = 0; r < A_rows; r += 4) {
+    A[r * width + 5] = 40.0f;
+  }
+
+  std::vector<double> reference(A_rows * B_cols);
+  for (Index r = 0; r < A_rows; ++r) {
+    double mean = 0.0, variance = 0.0;
+    for (Index k = 0; k < width; ++k) mean += A[r * width + k];
+    mean /= width;
+    for (Index k = 0; k < width; ++k) variance += (A[r * width + k] - mean) * (A[r * width + k] - mean);
+    double scale = 1.0 / std::sqrt(variance / width + epsilon);
+    for (Index c = 0; c < B_cols; ++c) {
+      double sum = bias[c];
+      for (Index k = 0; k < width; ++k)
+        sum += ((A[r * width + k] - mean) * scale * gamma[k] + beta[k]) * double(B[k * B_cols + c]);
+      reference[r * B_cols + c] = sum;
+    }
+  }
+
+  float B_mult = 127.0f / MaxAbsolute(B.begin(), B.end());
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareB(B.begin(), B_prep.begin(), B_mult, width, B_cols);
+
+  float A_mult = Int8::PrepareANormAuto(A.begin(), A_prep.begin(), gamma.data(), beta.data(), epsilon, false, 127.0f, A_rows, width);
+  AlignedVector<float> global_C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(1.0f / (A_mult * B_mult), bias.data(), global_C.begin()));
+
+  std::vector<float> unquant_mults(A_rows);
+  Int8::PrepareANormRows(A.begin(), A_prep.begin(), gamma.data(), beta.data(), epsilon, false, 127.0f, unquant_mults.data(), A_rows, width);
+  AlignedVector<float> rows_C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeRowsAndAddBiasAndWrite(1.0f / B_mult, unquant_mults.data(), bias.data(), rows_C.begin()));
+
+  double global_error = 0.0, rows_error = 0.0;
+  for (Index i = 0; i < reference.size(); ++i) {
+    global_error += std::fabs(global_C[i] - reference[i]);
+    rows_error += std::fabs(rows_C[i] - reference[i]);
+  }
+  CHECK(rows_error / reference.size() < 0.5);
+  CHECK(rows_error < global_error);
+}
+
 TEST_CASE ("Multiply SSE2 16bit", "[multiply]") {
   if (kCPU < CPUType::SSE2) return;
   TestMultiply<SSE2_16bit>(8, 256, 256, .1, 1, 0.01);
@@ -443,6 +1102,7 @@ TEST_CASE ("Multiply AVX2 16bit with bias", "[biased_multiply]") {
     TestMultiply<AVX512_8bit>(472, 256, 256, 0, 0.29, 0.059);
     TestMultiply<AVX512_8bit>(248, 256, 256, 0, 0.29, 0.059);
     TestMultiply<AVX512_8bit>(200, 256, 256, 0, 0.28, 0.06);
+    TestMultiply<AVX512_8bit>(200, 256, 24, 0, 0.28, 0.06);
   }
 
   TEST_CASE ("Multiply AVX512 8bit with bias", "[biased_multiply]") {
@@ -453,6 +1113,7 @@ TEST_CASE ("Multiply AVX2 16bit with bias", "[biased_multiply]") {
     TestMultiplyBias<AVX512_8bit>(472, 256, 256, 0, 0.29, 0.059);
     TestMultiplyBias<AVX512_8bit>(248, 256, 256, 0, 0.29, 0.059);
     TestMultiplyBias<AVX512_8bit>(200, 256, 256, 0, 0.28, 0.06);
+    TestMultiplyBias<AVX512_8bit>(200, 256, 24, 0, 0.28, 0.06);
   }
 
   #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
@@ -464,6 +1125,7 @@ TEST_CASE ("Multiply AVX2 16bit with bias", "[biased_multiply]") {
       TestMultiply<AVX512VNNI_8bit>(472, 256, 256, 0, 0.29, 0.059);
       TestMultiply<AVX512VNNI_8bit>(248, 256, 256, 0, 0.29, 0.059);
       TestMultiply<AVX512VNNI_8bit>(200, 256, 256, 0, 0.28, 0.06);
+      TestMultiply<AVX512VNNI_8bit>(200, 256, 24, 0, 0.28, 0.06);
     }
 
     TEST_CASE ("Multiply AVX512VNNI 8bit with bias", "[biased_multiply]") {
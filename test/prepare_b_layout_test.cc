@@ -0,0 +1,197 @@
+#include "test.h"
+#include "../aligned.h"
+#include "../avx2_gemm.h"
+#include "../avx512_gemm.h"
+#include "../sse2_gemm.h"
+#include "../ssse3_gemm.h"
+
+#include <algorithm>
+
+namespace intgemm {
+namespace {
+
+// PrepareB with From, then RelayoutB to To's layout, matches PrepareB with To.
+template <typename From, typename To>
+void TestRelayoutB(CPUType from, CPUType to) {
+  using Integer = typename From::Integer;
+  INFO("from " << From::kName << " to " << To::kName);
+  const Index rows = 128, cols = 24;
+  AlignedVector<float> input(rows * cols);
+  for (Index i = 0; i < input.size(); ++i) input[i] = float(int(i * 37 % 255) - 127);
+  AlignedVector<Integer> from_prepared(input.size()), to_prepared(input.size()), converted(input.size());
+  From::PrepareB(input.begin(), from_prepared.begin(), 1.f, rows, cols);
+  To::PrepareB(input.begin(), to_prepared.begin(), 1.f, rows, cols);
+  intgemm::RelayoutB(from_prepared.begin(), converted.begin(), rows * sizeof(Integer), cols, PreparedBLayout(from, sizeof(Integer)), PreparedBLayout(to, sizeof(Integer)));
+  for (std::size_t i = 0; i < converted.size(); ++i) {
+    if (converted[i] != to_prepared[i]) {
+      FAIL("Error at " << i << ", converted = " << int(converted[i]) << ", expected = " << int(to_prepared[i]));
+    }
+  }
+}
+
+TEST_CASE("RelayoutB 8bit", "") {
+  if (kCPU < CPUType::AVX2)
+    return;
+  TestRelayoutB<SSSE3_8bit, AVX2_8bit>(CPUType::SSSE3, CPUType::AVX2);
+  TestRelayoutB<AVX2_8bit, SSSE3_8bit>(CPUType::AVX2, CPUType::SSSE3);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW)
+    return;
+  TestRelayoutB<SSSE3_8bit, AVX512_8bit>(CPUType::SSSE3, CPUType::AVX512BW);
+  TestRelayoutB<AVX512_8bit, SSSE3_8bit>(CPUType::AVX512BW, CPUType::SSSE3);
+  TestRelayoutB<AVX2_8bit, AVX512_8bit>(CPUType::AVX2, CPUType::AVX512BW);
+  TestRelayoutB<AVX512_8bit, AVX2_8bit>(CPUType::AVX512BW, CPUType::AVX2);
+#endif
+}
+
+TEST_CASE("RelayoutB 16bit", "") {
+  if (kCPU < CPUType::AVX2)
+    return;
+  TestRelayoutB<SSE2_16bit, AVX2_16bit>(CPUType::SSE2, CPUType::AVX2);
+  TestRelayoutB<AVX2_16bit, SSE2_16bit>(CPUType::AVX2, CPUType::SSE2);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW)
+    return;
+  TestRelayoutB<SSE2_16bit, AVX512_16bit>(CPUType::SSE2, CPUType::AVX512BW);
+  TestRelayoutB<AVX512_16bit, SSE2_16bit>(CPUType::AVX512BW, CPUType::SSE2);
+  TestRelayoutB<AVX2_16bit, AVX512_16bit>(CPUType::AVX2, CPUType::AVX512BW);
+  TestRelayoutB<AVX512_16bit, AVX2_16bit>(CPUType::AVX512BW, CPUType::AVX2);
+#endif
+}
+
+// UnprepareB and UnprepareBTransposed recover the quantized B from PrepareB on Backend.
+template <typename Backend, typename Routine>
+void TestUnprepareB(CPUType cpu) {
+  using Integer = typename Backend::Integer;
+  INFO(Backend::kName);
+  const Index rows = 128, cols = 24;
+  AlignedVector<float> input(rows * cols);
+  for (Index i = 0; i < input.size(); ++i) input[i] = float(int(i * 37 % 255) - 127);
+  AlignedVector<Integer> prepared(input.size()), row_major(input.size()), transposed(input.size());
+  Backend::PrepareB(input.begin(), prepared.begin(), 1.f, rows, cols);
+  Routine::UnprepareB(prepared.begin(), row_major.begin(), cpu, rows, cols);
+  Routine::UnprepareBTransposed(prepared.begin(), transposed.begin(), cpu, rows, cols);
+  for (Index r = 0; r < rows; ++r) {
+    for (Index c = 0; c < cols; ++c) {
+      CHECK(int(row_major[r * cols + c]) == int(input[r * cols + c]));
+      CHECK(int(transposed[c * rows + r]) == int(input[r * cols + c]));
+    }
+  }
+}
+
+TEST_CASE("UnprepareB", "") {
+  if (kCPU < CPUType::SSSE3)
+    return;
+  TestUnprepareB<SSE2_16bit, Int16>(CPUType::SSE2);
+  TestUnprepareB<SSSE3_8bit, Int8>(CPUType::SSSE3);
+  if (kCPU < CPUType::AVX2)
+    return;
+  TestUnprepareB<AVX2_16bit, Int16>(CPUType::AVX2);
+  TestUnprepareB<AVX2_8bit, Int8>(CPUType::AVX2);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW)
+    return;
+  TestUnprepareB<AVX512_16bit, Int16>(CPUType::AVX512BW);
+  TestUnprepareB<AVX512_8bit, Int8>(CPUType::AVX512BW);
+#endif
+}
+
+// PrepareBRows on chunks of rows matches PrepareB of the whole B.
+template <typename Backend>
+void TestPrepareBRows(Index chunk) {
+  using Integer = typename Backend::Integer;
+  INFO(Backend::kName << " chunk " << chunk);
+  const Index rows = 256, cols = 24;
+  AlignedVector<float> input(rows * cols);
+  for (Index i = 0; i < input.size(); ++i) input[i] = float(int(i * 37 % 255) - 127) / 64.f;
+  AlignedVector<Integer> reference(input.size()), streamed(input.size());
+  Backend::PrepareB(input.begin(), reference.begin(), 64.f, rows, cols);
+  AlignedVector<float> buffer(chunk * cols);
+  for (Index begin = 0; begin < rows; begin += chunk) {
+    std::copy(input.begin() + begin * cols, input.begin() + (begin + chunk) * cols, buffer.begin());
+    Backend::PrepareBRows(buffer.begin(), streamed.begin(), 64.f, rows, cols, begin, chunk);
+  }
+  for (Index i = 0; i < input.size(); ++i)
+    CHECK(int(streamed[i]) == int(reference[i]));
+}
+
+TEST_CASE("PrepareBRows", "") {
+  if (kCPU < CPUType::SSSE3)
+    return;
+  TestPrepareBRows<SSE2_16bit>(SSE2_16bit::kBTileRow);
+  TestPrepareBRows<SSSE3_8bit>(SSSE3_8bit::kBTileRow);
+  TestPrepareBRows<Int16>(32);
+  TestPrepareBRows<Int8>(64);
+  TestPrepareBRows<Int8>(128);
+  if (kCPU < CPUType::AVX2)
+    return;
+  TestPrepareBRows<AVX2_16bit>(AVX2_16bit::kBTileRow);
+  TestPrepareBRows<AVX2_8bit>(AVX2_8bit::kBTileRow);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW)
+    return;
+  TestPrepareBRows<AVX512_16bit>(AVX512_16bit::kBTileRow);
+  TestPrepareBRows<AVX512_8bit>(AVX512_8bit::kBTileRow);
+#endif
+}
+
+// PrepareBQuantized and PrepareBQuantizedInPlace of quantized row-major B match PrepareB on Backend.
+template <typename Backend>
+void TestPrepareBQuantized() {
+  using Integer = typename Backend::Integer;
+  INFO(Backend::kName);
+  const Index rows = 256, cols = 24;
+  const Index register_bytes = sizeof(vector_t<Backend::kUses, Integer>);
+  AlignedVector<float> input(rows * cols);
+  AlignedVector<Integer> quantized(input.size()), reference(input.size()), prepared(input.size());
+  for (Index i = 0; i < input.size(); ++i) {
+    input[i] = float(int(i * 37 % 255) - 127);
+    quantized[i] = static_cast<Integer>(input[i]);
+  }
+  Backend::PrepareB(input.begin(), reference.begin(), 1.f, rows, cols);
+  PrepareBQuantized(quantized.begin(), prepared.begin(), rows, cols, register_bytes);
+  for (Index i = 0; i < input.size(); ++i)
+    CHECK(int(prepared[i]) == int(reference[i]));
+  PrepareBQuantizedInPlace(quantized.begin(), rows, cols, register_bytes);
+  for (Index i = 0; i < input.size(); ++i)
+    CHECK(int(quantized[i]) == int(reference[i]));
+}
+
+TEST_CASE("PrepareBQuantized", "") {
+  if (kCPU < CPUType::SSSE3)
+    return;
+  TestPrepareBQuantized<SSE2_16bit>();
+  TestPrepareBQuantized<SSSE3_8bit>();
+  if (kCPU < CPUType::AVX2)
+    return;
+  TestPrepareBQuantized<AVX2_16bit>();
+  TestPrepareBQuantized<AVX2_8bit>();
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW)
+    return;
+  TestPrepareBQuantized<AVX512_16bit>();
+  TestPrepareBQuantized<AVX512_8bit>();
+#endif
+}
+
+TEST_CASE("PrepareBQuantized dispatch", "") {
+  if (kCPU < CPUType::SSSE3)
+    return;
+  const Index rows = 128, cols = 16;
+  AlignedVector<float> input(rows * cols);
+  AlignedVector<int8_t> quantized(input.size()), reference(input.size()), prepared(input.size());
+  for (Index i = 0; i < input.size(); ++i) {
+    input[i] = float(int(i * 13 % 255) - 127);
+    quantized[i] = static_cast<int8_t>(input[i]);
+  }
+  Int8::PrepareB(input.begin(), reference.begin(), 1.f, rows, cols);
+  Int8::PrepareBQuantized(quantized.begin(), prepared.begin(), rows, cols);
+  Int8::PrepareBQuantizedInPlace(quantized.begin(), rows, cols);
+  for (Index i = 0; i < input.size(); ++i) {
+    CHECK(prepared[i] == reference[i]);
+    CHECK(quantized[i] == reference[i]);
+  }
+}
+
+}
+}
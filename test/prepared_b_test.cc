@@ -0,0 +1,91 @@
+#include "test.h"
+#include "../prepared_b.h"
+
+#include <random>
+
+namespace intgemm {
+namespace {
+
+// Column sums from PrepareBColumnSums match PrepareColumnSums on Backend.
+template <class Backend> void TestColumnSums(Index rows, Index cols) {
+  INFO(Backend::kName);
+  AlignedVector<float> input(rows * cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-2.f, 2.f);
+  for (auto& it : input) it = dist(gen);
+  AlignedVector<int8_t> reference(rows * cols), prepared(rows * cols);
+  AlignedVector<float> reference_sums(cols), sums(cols);
+  Backend::PrepareB(input.begin(), reference.begin(), 64.f, rows, cols);
+  Backend::PrepareBias(reference.begin(), rows, cols, callbacks::UnquantizeAndWrite(1.0f, reference_sums.begin()));
+  Backend::PrepareBColumnSums(input.begin(), prepared.begin(), 64.f, rows, cols, sums.begin());
+  for (Index i = 0; i < rows * cols; ++i)
+    CHECK(prepared[i] == reference[i]);
+  for (Index c = 0; c < cols; ++c)
+    CHECK(sums[c] == reference_sums[c]);
+}
+
+TEST_CASE("PrepareBColumnSums", "[prepared_b]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestColumnSums<SSSE3_8bit>(256, 32);
+  if (kCPU < CPUType::AVX2) return;
+  TestColumnSums<AVX2_8bit>(256, 32);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestColumnSums<AVX512_8bit>(256, 32);
+  TestColumnSums<AVX512_8bit>(4096, 8);
+#endif
+}
+
+TEST_CASE("PreparedB Int8Shift", "[prepared_b]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 8, width = 256, B_cols = 24;
+  const float alpha = 2.f, quant_mult = 127.f / alpha, unquant_mult = 1.f / (quant_mult * quant_mult);
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), bias(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-alpha, alpha);
+  for (auto& it : A) it = dist(gen);
+  for (auto& it : B) it = dist(gen);
+  for (auto& it : bias) it = dist(gen);
+
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8Shift::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+  Int8Shift::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+  AlignedVector<float> shifted_bias(B_cols), reference(A_rows * B_cols);
+  Int8Shift::PrepareBias(B_prep.begin(), width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(-alpha * alpha / 127.f, bias.begin(), shifted_bias.begin()));
+  Int8Shift::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, shifted_bias.begin(), reference.begin()));
+
+  PreparedB<int8_t> prepared = Int8Shift::PrepareBOwned(B.begin(), quant_mult, width, B_cols);
+  CHECK(prepared.Rows() == width);
+  CHECK(prepared.Cols() == B_cols);
+  CHECK(prepared.QuantMult() == quant_mult);
+  CHECK(prepared.CPU() == kCPU);
+  for (Index i = 0; i < B.size(); ++i)
+    CHECK(prepared.get()[i] == B_prep[i]);
+  AlignedVector<float> prepared_bias(B_cols), output(A_rows * B_cols);
+  Int8Shift::PrepareBias(prepared, unquant_mult, bias.begin(), prepared_bias.begin());
+  for (Index c = 0; c < B_cols; ++c)
+    CHECK(prepared_bias[c] == Approx(shifted_bias[c]).epsilon(0.0001f).margin(0.0001f));
+  Int8Shift::Multiply(A_prep.begin(), prepared, A_rows, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, prepared_bias.begin(), output.begin()));
+  for (Index i = 0; i < output.size(); ++i)
+    CHECK(output[i] == Approx(reference[i]).epsilon(0.0001f).margin(0.0001f));
+}
+
+TEST_CASE("PreparedB layout mismatch", "[prepared_b]") {
+  if (kCPU < CPUType::SSSE3) return;
+  AlignedVector<float> A(8 * 64), output(8 * 8);
+  for (auto& it : A) it = 1.f;
+  AlignedVector<int8_t> A_prep(A.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), 1.f, 8, 64);
+  PreparedB<int8_t> B = Int8::PrepareBOwned(A.begin(), 1.f, 64, 8);
+  Int8::Multiply(A_prep.begin(), B, 8, callbacks::UnquantizeAndWrite(1.f, output.begin()));
+  CHECK(output[0] == 64.f);
+
+  PreparedB<int8_t> other(64, 8, 1.f, PreparedBLayout(kCPU, 1) == 16 ? CPUType::AVX2 : CPUType::SSSE3);
+  CHECK_THROWS_AS(Int8::Multiply(A_prep.begin(), other, 8, callbacks::UnquantizeAndWrite(1.f, output.begin())), PreparedBLayoutMismatch);
+  PreparedB<int16_t> other16(64, 8, 1.f, PreparedBLayout(kCPU, 2) == 16 ? CPUType::AVX2 : CPUType::SSE2);
+  AlignedVector<int16_t> A16(A.size());
+  CHECK_THROWS_AS(Int16::Multiply(A16.begin(), other16, 8, callbacks::UnquantizeAndWrite(1.f, output.begin())), PreparedBLayoutMismatch);
+}
+
+} // namespace
+} // namespace intgemm
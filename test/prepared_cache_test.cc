@@ -0,0 +1,98 @@
+#include "test.h"
+#include "../prepared_cache.h"
+
+#include <limits>
+
+namespace intgemm {
+namespace {
+
+void Fill(AlignedVector<float> &input, int seed) {
+  for (Index i = 0; i < input.size(); ++i) input[i] = float(int((i + seed) * 37 % 255) - 127) / 64.f;
+}
+
+TEST_CASE("PreparedBCache hits", "[prepared_cache]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index rows = 128, cols = 16;
+  AlignedVector<float> input(rows * cols);
+  Fill(input, 0);
+  AlignedVector<int8_t> reference(rows * cols);
+  Int8::PrepareB(input.begin(), reference.begin(), 64.f, rows, cols);
+
+  PreparedBCache cache(1 << 20);
+  std::shared_ptr<const PreparedB<int8_t> > first = cache.PrepareB<Int8>(input.begin(), 64.f, rows, cols);
+  std::shared_ptr<const PreparedB<int8_t> > second = cache.PrepareB<Int8>(input.begin(), 64.f, rows, cols);
+  CHECK(cache.Misses() == 1);
+  CHECK(cache.Hits() == 1);
+  CHECK(first == second);
+  // The prepared B and its column sums.
+  CHECK(cache.Bytes() == rows * cols + cols * sizeof(float));
+  CHECK(cache.Bytes() == first->Bytes());
+  REQUIRE(first);
+  CHECK(first->Rows() == rows);
+  CHECK(first->Cols() == cols);
+  CHECK(first->QuantMult() == 64.f);
+  for (Index i = 0; i < rows * cols; ++i)
+    CHECK(first->get()[i] == reference[i]);
+
+  // Any change to the key misses.
+  CHECK(cache.PrepareB<Int8>(input.begin(), 32.f, rows, cols) != first);
+  CHECK(cache.PrepareB<Int16>(input.begin(), 64.f, rows, cols));
+  input[rows * cols - 1] += 1.f;
+  CHECK(cache.PrepareB<Int8>(input.begin(), 64.f, rows, cols) != first);
+  CHECK(cache.Misses() == 4);
+  CHECK(cache.Bytes() == 3 * (rows * cols + cols * sizeof(float)) + 2 * rows * cols);
+}
+
+TEST_CASE("PreparedBCache budget", "[prepared_cache]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index rows = 64, cols = 8;
+  const std::size_t entry = rows * cols + cols * sizeof(float);
+  AlignedVector<float> a(rows * cols), b(rows * cols), c(rows * cols);
+  Fill(a, 1);
+  Fill(b, 2);
+  Fill(c, 3);
+  PreparedBCache cache(2 * entry);
+  std::shared_ptr<const PreparedB<int8_t> > held = cache.PrepareB<Int8>(a.begin(), 1.f, rows, cols);
+  const int8_t first = held->get()[0];
+  cache.PrepareB<Int8>(b.begin(), 1.f, rows, cols);
+  // a is used more recently than b, so c evicts b.
+  cache.PrepareB<Int8>(a.begin(), 1.f, rows, cols);
+  cache.PrepareB<Int8>(c.begin(), 1.f, rows, cols);
+  CHECK(cache.Bytes() == 2 * entry);
+  CHECK(cache.Misses() == 3);
+  cache.PrepareB<Int8>(a.begin(), 1.f, rows, cols);
+  CHECK(cache.Misses() == 3);
+  cache.PrepareB<Int8>(b.begin(), 1.f, rows, cols);
+  CHECK(cache.Misses() == 4);
+
+  // Handles outlive eviction.
+  cache.SetBudget(0);
+  CHECK(cache.Bytes() == 0);
+  CHECK(held->get()[0] == first);
+  cache.SetBudget(entry);
+  cache.PrepareB<Int8>(a.begin(), 1.f, rows, cols);
+  CHECK(cache.Bytes() == entry);
+  cache.Clear();
+  CHECK(cache.Bytes() == 0);
+}
+
+TEST_CASE("PreparedBCache NaN quant_mult", "[prepared_cache]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index rows = 64, cols = 8;
+  const std::size_t entry = rows * cols + cols * sizeof(float);
+  AlignedVector<float> a(rows * cols), b(rows * cols);
+  Fill(a, 1);
+  Fill(b, 2);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  PreparedBCache cache(entry);
+  cache.PrepareB<Int8>(a.begin(), nan, rows, cols);
+  cache.PrepareB<Int8>(a.begin(), nan, rows, cols);
+  CHECK(cache.Misses() == 1);
+  CHECK(cache.Hits() == 1);
+  // Evicting the NaN entry finds it again.
+  cache.PrepareB<Int8>(b.begin(), 1.f, rows, cols);
+  CHECK(cache.Bytes() == entry);
+}
+
+} // namespace
+} // namespace intgemm
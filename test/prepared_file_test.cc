@@ -0,0 +1,166 @@
+#include "test.h"
+#include "../prepared_file.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace intgemm {
+namespace {
+
+// Temporary file name, removed on destruction.
+class TempPath {
+  public:
+    TempPath() {
+      char name[] = "/tmp/intgemm_prepared_XXXXXX";
+      int fd = mkstemp(name);
+      REQUIRE(fd >= 0);
+      close(fd);
+      path_ = name;
+    }
+    ~TempPath() { std::remove(path_.c_str()); }
+    const char *c_str() const { return path_.c_str(); }
+  private:
+    std::string path_;
+};
+
+// Overwrite a field of the header in place.
+template <class T> void Patch(const char *path, std::size_t offset, T value) {
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(offset);
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class Routine> void TestRoundTrip(bool with_bias) {
+  typedef typename Routine::Integer Integer;
+  const Index rows = 256, cols = 24;
+  AlignedVector<float> input(rows * cols);
+  std::vector<float> bias(cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (auto& it : input) it = dist(gen);
+  for (auto& it : bias) it = dist(gen);
+  AlignedVector<Integer> prepared(rows * cols);
+  Routine::PrepareB(input.begin(), prepared.begin(), 64.f, rows, cols);
+
+  TempPath path;
+  WritePreparedB(path.c_str(), prepared.begin(), rows, cols, 64.f, with_bias ? bias.data() : nullptr);
+  PreparedBFile file(path.c_str());
+  CHECK(file.Rows() == rows);
+  CHECK(file.Cols() == cols);
+  CHECK(file.QuantMult() == 64.f);
+  const Integer *mapped = file.B<Integer>();
+  CHECK(reinterpret_cast<uintptr_t>(mapped) % 64 == 0);
+  for (Index i = 0; i < rows * cols; ++i)
+    CHECK(mapped[i] == prepared[i]);
+  if (with_bias) {
+    REQUIRE(file.Bias() != nullptr);
+    CHECK(reinterpret_cast<uintptr_t>(file.Bias()) % 64 == 0);
+    for (Index c = 0; c < cols; ++c)
+      CHECK(file.Bias()[c] == bias[c]);
+  } else {
+    CHECK(file.Bias() == nullptr);
+  }
+}
+
+TEST_CASE("PreparedBFile round trip", "[prepared_file]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestRoundTrip<Int8>(false);
+  TestRoundTrip<Int8>(true);
+  TestRoundTrip<Int16>(true);
+}
+
+TEST_CASE("PreparedBFile rejects mismatches", "[prepared_file]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index rows = 64, cols = 8;
+  AlignedVector<float> input(rows * cols);
+  for (Index i = 0; i < input.size(); ++i) input[i] = float(i % 7) - 3.f;
+  AlignedVector<int8_t> prepared(rows * cols);
+  Int8::PrepareB(input.begin(), prepared.begin(), 1.f, rows, cols);
+
+  TempPath path;
+  WritePreparedB(path.c_str(), prepared.begin(), rows, cols, 1.f);
+  {
+    PreparedBFile file(path.c_str());
+    CHECK_THROWS_AS(file.B<int16_t>(), PreparedFileError);
+  }
+
+  // Layout of another register width.
+  Patch<uint32_t>(path.c_str(), offsetof(PreparedBHeader, register_bytes), PreparedBLayout(kCPU, 1) == 16 ? 64 : 16);
+  CHECK_THROWS_AS(PreparedBFile(path.c_str()), PreparedFileError);
+  // No layout, as from a CPU that cannot multiply 8-bit.
+  Patch<uint32_t>(path.c_str(), offsetof(PreparedBHeader, register_bytes), 0);
+  CHECK_THROWS_AS(PreparedBFile(path.c_str()), PreparedFileError);
+
+  WritePreparedB(path.c_str(), prepared.begin(), rows, cols, 1.f);
+  Patch<uint32_t>(path.c_str(), offsetof(PreparedBHeader, version), kPreparedBVersion + 1);
+  CHECK_THROWS_AS(PreparedBFile(path.c_str()), PreparedFileError);
+
+  // More rows than the file holds.
+  WritePreparedB(path.c_str(), prepared.begin(), rows, cols, 1.f);
+  Patch<uint32_t>(path.c_str(), offsetof(PreparedBHeader, rows), rows * 2);
+  CHECK_THROWS_AS(PreparedBFile(path.c_str()), PreparedFileError);
+
+  // Offsets so large that adding the length wraps around.
+  WritePreparedB(path.c_str(), prepared.begin(), rows, cols, 1.f);
+  Patch<uint64_t>(path.c_str(), offsetof(PreparedBHeader, data_offset), ~uint64_t(63));
+  CHECK_THROWS_AS(PreparedBFile(path.c_str()), PreparedFileError);
+  std::vector<float> bias(cols, 1.f);
+  WritePreparedB(path.c_str(), prepared.begin(), rows, cols, 1.f, bias.data());
+  Patch<uint64_t>(path.c_str(), offsetof(PreparedBHeader, bias_offset), ~uint64_t(63));
+  CHECK_THROWS_AS(PreparedBFile(path.c_str()), PreparedFileError);
+
+  WritePreparedB(path.c_str(), prepared.begin(), rows, cols, 1.f);
+  Patch<char>(path.c_str(), 0, 'x');
+  CHECK_THROWS_AS(PreparedBFile(path.c_str()), PreparedFileError);
+
+  CHECK_THROWS_AS(PreparedBFile("/nonexistent/prepared"), PreparedFileError);
+}
+
+TEST_CASE("SharedPreparedB", "[prepared_file]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index rows = 128, cols = 16;
+  AlignedVector<float> input(rows * cols);
+  for (Index i = 0; i < input.size(); ++i) input[i] = float(i % 11) - 5.f;
+  AlignedVector<int8_t> reference(rows * cols);
+  Int8::PrepareB(input.begin(), reference.begin(), 2.f, rows, cols);
+
+  const std::string name = "/intgemm_test_" + std::to_string(getpid());
+  {
+    SharedPreparedB shared(name.c_str(), 1, rows, cols, 2.f, true);
+    CHECK(reinterpret_cast<uintptr_t>(shared.B<int8_t>()) % 64 == 0);
+    CHECK_THROWS_AS(shared.B<int16_t>(), PreparedFileError);
+    Int8::PrepareB(input.begin(), shared.B<int8_t>(), 2.f, rows, cols);
+    for (Index c = 0; c < cols; ++c) shared.Bias()[c] = float(c);
+    // Not visible before Commit.
+    CHECK_THROWS_AS(PreparedBFile(name.c_str(), PreparedBFile::kSharedMemory), PreparedFileError);
+    CHECK_THROWS_AS(SharedPreparedB(name.c_str(), 1, rows, cols, 2.f), PreparedFileError);
+    shared.Commit();
+  }
+  {
+    PreparedBFile file(name.c_str(), PreparedBFile::kSharedMemory);
+    CHECK(file.Rows() == rows);
+    CHECK(file.Cols() == cols);
+    CHECK(file.QuantMult() == 2.f);
+    for (Index i = 0; i < rows * cols; ++i)
+      CHECK(file.B<int8_t>()[i] == reference[i]);
+    REQUIRE(file.Bias() != nullptr);
+    CHECK(file.Bias()[cols - 1] == float(cols - 1));
+    RemoveSharedPreparedB(name.c_str());
+    // The mapping outlives the name.
+    CHECK(file.B<int8_t>()[0] == reference[0]);
+  }
+  CHECK_THROWS_AS(PreparedBFile(name.c_str(), PreparedBFile::kSharedMemory), PreparedFileError);
+
+  // Without Commit the object is removed.
+  { SharedPreparedB abandoned(name.c_str(), 1, rows, cols, 2.f); }
+  CHECK_THROWS_AS(RemoveSharedPreparedB(name.c_str()), PreparedFileError);
+}
+
+} // namespace
+} // namespace intgemm
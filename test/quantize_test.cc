@@ -5,9 +5,13 @@
 #include "../sse2_gemm.h"
 #include "../ssse3_gemm.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <math.h>
+#include <random>
+#include <vector>
 
 namespace intgemm {
 namespace {
@@ -132,6 +136,268 @@ TEST_CASE ("Quantize AVX2", "[quantize]") {
   }
 #endif
 
+// QuantizeAuto must match Quantize with 127 / MaxAbsolute, wherever the maximum is.
+template <class Integer> void TestQuantizeAuto(
+    float (*QuantizeAuto)(const float *, Integer *, float, Index),
+    void (*Quantize)(const float *, Integer *, float, Index),
+    float max_quantized, Index size, Index max_at) {
+  AlignedVector<float> input(size);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (Index i = 0; i < size; ++i)
+    input[i] = (i == max_at) ? -7.5f : dist(gen);
+
+  AlignedVector<Integer> output(size);
+  float quant_mult = QuantizeAuto(input.begin(), output.begin(), max_quantized, size);
+  CHECK(quant_mult == max_quantized / MaxAbsolute(input.begin(), input.end()));
+
+  AlignedVector<Integer> reference(size);
+  Quantize(input.begin(), reference.begin(), quant_mult, size);
+  for (Index i = 0; i < size; ++i)
+    CHECK(output[i] == reference[i]);
+}
+
+TEST_CASE("QuantizeAuto", "[quantize]") {
+  if (kCPU < CPUType::SSSE3) return;
+  // Maximum in the first block, in a later block (redoing the earlier ones) and in the last one.
+  for (Index max_at : {Index(5), Index(40000), Index(65600)}) {
+    TestQuantizeAuto<int8_t>(Int8::QuantizeAuto, Int8::Quantize, 127.f, 65664, max_at);
+    TestQuantizeAuto<uint8_t>(Int8Shift::QuantizeUAuto, Int8Shift::QuantizeU, 127.f, 65664, max_at);
+    TestQuantizeAuto<int16_t>(Int16::QuantizeAuto, Int16::Quantize, 1024.f, 65664, max_at);
+  }
+  TestQuantizeAuto<int8_t>(Int8::QuantizeAuto, Int8::Quantize, 127.f, 64, 3);
+}
+
+TEST_CASE("QuantizeAuto zeros", "[quantize]") {
+  if (kCPU < CPUType::SSSE3) return;
+  AlignedVector<float> input(20000);
+  for (auto& it : input) it = 0.f;
+  input[19999] = 0.5f;
+  AlignedVector<int8_t> output(input.size());
+  CHECK(Int8::QuantizeAuto(input.begin(), output.begin(), 127.f, input.size()) == 254.f);
+  for (Index i = 0; i < 19999; ++i)
+    CHECK(output[i] == 0);
+  CHECK(output[19999] == 127);
+}
+
+void TestQuantizeColumnScaled(void (*backend)(const float *, int8_t *, float, const float *, Index, Index), Index rows, Index cols) {
+  INFO("rows " << rows << " cols " << cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-4.f, 4.f);
+  std::uniform_real_distribution<float> mult_dist(0.1f, 3.f);
+  std::vector<float> input(rows * cols), column_mults(cols);
+  for (auto& it : input) it = dist(gen);
+  for (auto& it : column_mults) it = mult_dist(gen);
+  const float quant_mult = 20.f;
+  std::vector<int8_t> output(rows * cols);
+  backend(input.data(), output.data(), quant_mult, column_mults.data(), rows, cols);
+  for (Index r = 0; r < rows; ++r) {
+    for (Index c = 0; c < cols; ++c) {
+      float expected = std::nearbyint(input[r * cols + c] * (quant_mult * column_mults[c]));
+      expected = std::min(127.f, std::max(-127.f, expected));
+      CHECK(int(output[r * cols + c]) == int(expected));
+    }
+  }
+}
+
+TEST_CASE("QuantizeColumnScaled", "[quantize]") {
+  if (kCPU < CPUType::SSE2) return;
+  for (Index cols : {Index(8), Index(64), Index(136), Index(33)}) {
+    TestQuantizeColumnScaled(sse2::QuantizeColumnScaled, 5, cols);
+    if (kCPU >= CPUType::AVX2) TestQuantizeColumnScaled(avx2::QuantizeColumnScaled, 5, cols);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+    if (kCPU >= CPUType::AVX512BW) TestQuantizeColumnScaled(avx512f::QuantizeColumnScaled, 5, cols);
+#endif
+  }
+}
+
+template <class Integer> void TestQuantizeRowScaled(void (*backend)(const float *, Integer *, const float *, Index, Index), Index rows, Index cols, float max_mult) {
+  INFO("rows " << rows << " cols " << cols);
+  const float limit = std::numeric_limits<Integer>::max();
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-4.f, 4.f);
+  std::uniform_real_distribution<float> mult_dist(2.f, max_mult);
+  std::vector<float> input(rows * cols), row_mults(rows);
+  for (auto& it : input) it = dist(gen);
+  for (auto& it : row_mults) it = mult_dist(gen);
+  std::vector<Integer> output(rows * cols);
+  backend(input.data(), output.data(), row_mults.data(), rows, cols);
+  for (Index r = 0; r < rows; ++r) {
+    for (Index c = 0; c < cols; ++c) {
+      float expected = std::nearbyint(input[r * cols + c] * row_mults[r]);
+      expected = std::min(limit, std::max(sizeof(Integer) == 1 ? -limit : -limit - 1, expected));
+      CHECK(int(output[r * cols + c]) == int(expected));
+    }
+  }
+}
+
+TEST_CASE("QuantizeRowScaled", "[quantize]") {
+  if (kCPU < CPUType::SSE2) return;
+  for (Index cols : {Index(8), Index(64), Index(136), Index(33)}) {
+    TestQuantizeRowScaled<int8_t>(sse2::QuantizeRowScaled, 5, cols, 60.f);
+    TestQuantizeRowScaled<int16_t>(sse2::QuantizeRowScaled16, 5, cols, 10000.f);
+    // Products beyond the int32_t range still saturate.
+    TestQuantizeRowScaled<int16_t>(sse2::QuantizeRowScaled16, 5, cols, 1e10f);
+    if (kCPU >= CPUType::AVX2) {
+      TestQuantizeRowScaled<int8_t>(avx2::QuantizeRowScaled, 5, cols, 60.f);
+      TestQuantizeRowScaled<int16_t>(avx2::QuantizeRowScaled16, 5, cols, 10000.f);
+      TestQuantizeRowScaled<int16_t>(avx2::QuantizeRowScaled16, 5, cols, 1e10f);
+    }
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+    if (kCPU >= CPUType::AVX512BW) {
+      TestQuantizeRowScaled<int8_t>(avx512f::QuantizeRowScaled, 5, cols, 60.f);
+      TestQuantizeRowScaled<int16_t>(avx512f::QuantizeRowScaled16, 5, cols, 10000.f);
+      TestQuantizeRowScaled<int16_t>(avx512f::QuantizeRowScaled16, 5, cols, 1e10f);
+    }
+#endif
+  }
+}
+
+// Compare with the Hadamard matrix written out: H[i][j] = (-1)^popcount(i & j).
+void TestHadamard(void (*rotate)(float *, const float *, Index, Index, Index),
+                  void (*quantize)(const float *, int8_t *, float, const float *, Index, Index, Index),
+                  Index block, Index rows, Index cols) {
+  INFO("block " << block << " rows " << rows << " cols " << cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  AlignedVector<float> input(rows * cols), rotated(rows * cols);
+  for (auto& it : input) it = dist(gen);
+  std::vector<float> signs(cols);
+  HadamardSigns(7, cols, signs.data());
+  std::copy(input.begin(), input.end(), rotated.begin());
+  rotate(rotated.begin(), signs.data(), block, rows, cols);
+  const float quant_mult = 20.f;
+  AlignedVector<int8_t> quantized(rows * cols);
+  quantize(input.begin(), quantized.begin(), quant_mult, signs.data(), block, rows, cols);
+  for (Index r = 0; r < rows; ++r) {
+    for (Index b = 0; b < cols; b += block) {
+      for (Index i = 0; i < block; ++i) {
+        double expected = 0.0;
+        for (Index j = 0; j < block; ++j) {
+          double h = (__builtin_popcount(i & j) & 1) ? -1.0 : 1.0;
+          expected += h * signs[b + j] * input[r * cols + b + j];
+        }
+        expected /= std::sqrt(double(block));
+        CHECK(rotated[r * cols + b + i] == Approx(expected).margin(1e-5));
+        double clipped = std::min(127.0, std::max(-127.0, expected * quant_mult));
+        CHECK(std::fabs(quantized[r * cols + b + i] - clipped) <= 0.51);
+      }
+    }
+  }
+}
+
+TEST_CASE("Hadamard", "[quantize]") {
+  if (kCPU < CPUType::SSE2) return;
+  for (Index block : {Index(64), Index(256)}) {
+    TestHadamard(sse2::RotateHadamard, sse2::QuantizeHadamard, block, 3, 512);
+    if (kCPU >= CPUType::AVX2) TestHadamard(avx2::RotateHadamard, avx2::QuantizeHadamard, block, 3, 512);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+    if (kCPU >= CPUType::AVX512BW) TestHadamard(avx512f::RotateHadamard, avx512f::QuantizeHadamard, block, 3, 512);
+#endif
+  }
+}
+
+void TestNormalizeRow(float (*backend)(const float *, const float *, const float *, float, float, Index, float *), Index cols) {
+  INFO("cols " << cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-4.f, 4.f);
+  std::vector<float> input(cols), gamma(cols), beta(cols), output(cols);
+  for (auto& it : input) it = dist(gen);
+  for (auto& it : gamma) it = dist(gen);
+  for (auto& it : beta) it = dist(gen);
+  for (const float *b : {static_cast<const float *>(beta.data()), static_cast<const float *>(nullptr)}) {
+    float max = backend(input.data(), gamma.data(), b, 0.5f, 0.25f, cols, output.data());
+    float expected_max = 0.f;
+    for (Index c = 0; c < cols; ++c) {
+      float expected = (input[c] - 0.5f) * 0.25f * gamma[c] + (b ? b[c] : 0.f);
+      CHECK(output[c] == Approx(expected).epsilon(1e-5));
+      expected_max = std::max(expected_max, std::fabs(expected));
+    }
+    CHECK(max == Approx(expected_max).epsilon(1e-5));
+  }
+}
+
+TEST_CASE("NormalizeRow", "[quantize]") {
+  if (kCPU < CPUType::SSE2) return;
+  for (Index cols : {Index(64), Index(200), Index(33)}) {
+    TestNormalizeRow(sse2::NormalizeRow, cols);
+    if (kCPU >= CPUType::AVX2) TestNormalizeRow(avx2::NormalizeRow, cols);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+    if (kCPU >= CPUType::AVX512BW) TestNormalizeRow(avx512f::NormalizeRow, cols);
+#endif
+  }
+}
+
+// Fused normalization + quantization against normalizing in double and then
+// quantizing.  Rounding may differ by one where the float result is at .5.
+template <class Integer> void TestNormQuantize(
+    float (*norm_quantize)(const float *, Integer *, const float *, const float *, float, bool, float, float, float *, Index, Index),
+    int shift, float max_quantized, bool rms, bool per_row) {
+  INFO("rms " << rms << " per_row " << per_row);
+  // More rows than one buffer of the fused routine holds.
+  const Index rows = 150, cols = 256;
+  const float epsilon = 1e-5f;
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  AlignedVector<float> input(rows * cols);
+  std::vector<float> gamma(cols), beta(cols);
+  for (Index i = 0; i < input.size(); ++i) input[i] = dist(gen) * (1 + i / cols % 5) + 0.5f;
+  for (auto& it : gamma) it = 1.f + dist(gen);
+  for (auto& it : beta) it = dist(gen);
+
+  std::vector<double> normalized(rows * cols), row_max(rows, 0.0);
+  double max = 0.0;
+  for (Index r = 0; r < rows; ++r) {
+    const float *row = input.begin() + r * cols;
+    double mean = 0.0, squares = 0.0;
+    for (Index c = 0; c < cols; ++c) mean += row[c];
+    mean /= cols;
+    for (Index c = 0; c < cols; ++c) squares += rms ? double(row[c]) * row[c] : (row[c] - mean) * (row[c] - mean);
+    if (rms) mean = 0.0;
+    double scale = 1.0 / std::sqrt(squares / cols + epsilon);
+    for (Index c = 0; c < cols; ++c) {
+      double value = (row[c] - mean) * scale * gamma[c] + beta[c];
+      normalized[r * cols + c] = value;
+      row_max[r] = std::max(row_max[r], std::fabs(value));
+    }
+    max = std::max(max, row_max[r]);
+  }
+
+  AlignedVector<Integer> output(rows * cols);
+  std::vector<float> unquant_mults(rows);
+  float quant_mult = norm_quantize(input.begin(), output.begin(), gamma.data(), beta.data(), epsilon, rms, 0.f, max_quantized, per_row ? unquant_mults.data() : nullptr, rows, cols);
+  if (!per_row) CHECK(quant_mult == Approx(max_quantized / max).epsilon(1e-4));
+  for (Index r = 0; r < rows; ++r) {
+    double mult = quant_mult;
+    if (per_row) {
+      CHECK(unquant_mults[r] == Approx(row_max[r] / max_quantized).epsilon(1e-4));
+      mult = 1.0 / unquant_mults[r];
+    }
+    for (Index c = 0; c < cols; ++c) {
+      double expected = std::min<double>(max_quantized, std::max<double>(-max_quantized, normalized[r * cols + c] * mult));
+      CHECK(std::fabs(int(output[r * cols + c]) - shift - expected) <= 1.01);
+    }
+  }
+
+  // A fixed multiplier gives the same as the chosen one when it is the same.
+  AlignedVector<Integer> fixed(rows * cols);
+  if (!per_row) {
+    norm_quantize(input.begin(), fixed.begin(), gamma.data(), beta.data(), epsilon, rms, quant_mult, 0.f, nullptr, rows, cols);
+    for (Index i = 0; i < fixed.size(); ++i) CHECK(fixed[i] == output[i]);
+  }
+}
+
+TEST_CASE("PrepareANorm", "[quantize]") {
+  if (kCPU < CPUType::SSSE3) return;
+  for (bool rms : {false, true}) {
+    TestNormQuantize<int8_t>(Int8::NormQuantize, 0, 127.f, rms, false);
+    TestNormQuantize<int8_t>(Int8::NormQuantize, 0, 127.f, rms, true);
+    TestNormQuantize<uint8_t>(Int8Shift::NormQuantizeU, 127, 127.f, rms, false);
+    TestNormQuantize<int16_t>(Int16::NormQuantize, 0, 1024.f, rms, false);
+    TestNormQuantize<int16_t>(Int16::NormQuantize, 0, 1024.f, rms, true);
+  }
+}
+
 TEST_CASE("QuantizeStd SSSE3", "[VectorMeanStd]") {
   if (kCPU < CPUType::SSSE3) return;
   testVectorMeanStd<sse2::VectorMeanStd>(64);
@@ -182,5 +448,39 @@ TEST_CASE("QuantizeStd AVX512", "[VectorMeanStd]") {
 }
 #endif
 
+// Values far from zero: E[x^2] - E[x]^2 in float would cancel catastrophically.
+void testVectorMeanStdLargeMean(MeanStd (*backend)(const float *, const float *, bool), int num_items) {
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(999.0f, 1001.0f);
+  AlignedVector<float> inputVec(num_items);
+  double sum = 0;
+  for (auto&& it : inputVec) {
+    it = dist(gen);
+    sum += it;
+  }
+  double mean = sum / num_items;
+  double squares = 0;
+  for (auto&& it : inputVec) {
+    squares += (it - mean) * (it - mean);
+  }
+  double stddev = std::sqrt(squares / num_items);
+
+  MeanStd fast = backend(inputVec.begin(), inputVec.end(), false);
+  CHECK_MESSAGE(fabs(fast.mean - mean) <= 1e-3, "Items: " << num_items << " Reference mean: " << mean << " actual: " << fast.mean);
+  CHECK_MESSAGE(fabs(fast.stddev - stddev) <= 1e-4, "Items: " << num_items << " Reference stddev: " << stddev << " actual: " << fast.stddev);
+}
+
+TEST_CASE("QuantizeStd large mean", "[VectorMeanStd]") {
+  if (kCPU < CPUType::SSSE3) return;
+  testVectorMeanStdLargeMean(sse2::VectorMeanStd, 120832);
+  if (kCPU >= CPUType::AVX2) testVectorMeanStdLargeMean(avx2::VectorMeanStd, 120832);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU >= CPUType::AVX512BW) testVectorMeanStdLargeMean(avx512f::VectorMeanStd, 120832);
+#endif
+  // Several thread chunks and a partial last one.
+  testVectorMeanStdLargeMean(intgemm::VectorMeanStd, 1 << 20);
+  testVectorMeanStdLargeMean(intgemm::VectorMeanStd, 300032);
+}
+
 } // namespace
 } // namespace intgemm
@@ -0,0 +1,105 @@
+#include "test.h"
+#include "../aligned.h"
+#include "../avx2_gemm.h"
+#include "../avx512_gemm.h"
+#include "../sse2_gemm.h"
+
+#include <cmath>
+#include <random>
+
+namespace intgemm {
+namespace {
+
+struct RowStatistics {
+  void (*max_absolute)(const float *input, Index rows, Index cols, Index stride, float *output);
+  void (*sum)(const float *input, Index rows, Index cols, Index stride, float *output);
+  void (*mean_std)(const float *input, Index rows, Index cols, Index stride, bool absolute, MeanStd *output);
+  void (*column_max_absolute)(const float *input, Index rows, Index cols, Index stride, float *output);
+};
+
+void TestRowStatistics(RowStatistics backend, Index rows, Index cols, Index stride) {
+  INFO("rows " << rows << " cols " << cols << " stride " << stride);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+  // One float of padding in front so rows are not aligned.
+  AlignedVector<float> storage(rows * stride + 1);
+  for (auto& it : storage) {
+    it = dist(gen) + 3.0f;
+  }
+  const float *input = storage.begin() + 1;
+
+  std::vector<float> max_absolute(rows), sum(rows);
+  std::vector<MeanStd> mean_std(rows), mean_std_absolute(rows);
+  backend.max_absolute(input, rows, cols, stride, max_absolute.data());
+  backend.sum(input, rows, cols, stride, sum.data());
+  backend.mean_std(input, rows, cols, stride, false, mean_std.data());
+  backend.mean_std(input, rows, cols, stride, true, mean_std_absolute.data());
+  std::vector<float> column_max_absolute(cols);
+  backend.column_max_absolute(input, rows, cols, stride, column_max_absolute.data());
+
+  for (Index r = 0; r < rows; ++r) {
+    const float *row = input + r * stride;
+    float ref_max = 0.0f;
+    double ref_sum = 0.0, ref_abs_sum = 0.0;
+    for (Index c = 0; c < cols; ++c) {
+      ref_max = std::max(ref_max, std::fabs(row[c]));
+      ref_sum += row[c];
+      ref_abs_sum += std::fabs(row[c]);
+    }
+    double ref_mean = ref_sum / cols, ref_abs_mean = ref_abs_sum / cols;
+    double squares = 0.0, abs_squares = 0.0;
+    for (Index c = 0; c < cols; ++c) {
+      squares += (row[c] - ref_mean) * (row[c] - ref_mean);
+      abs_squares += (std::fabs(row[c]) - ref_abs_mean) * (std::fabs(row[c]) - ref_abs_mean);
+    }
+    INFO("row " << r);
+    CHECK(max_absolute[r] == ref_max);
+    CHECK(sum[r] == Approx(ref_sum).epsilon(1e-5));
+    CHECK(mean_std[r].mean == Approx(ref_mean).epsilon(1e-5));
+    CHECK(mean_std[r].stddev == Approx(std::sqrt(squares / cols)).epsilon(1e-4));
+    CHECK(mean_std_absolute[r].mean == Approx(ref_abs_mean).epsilon(1e-5));
+    CHECK(mean_std_absolute[r].stddev == Approx(std::sqrt(abs_squares / cols)).epsilon(1e-4));
+  }
+  for (Index c = 0; c < cols; ++c) {
+    float ref_max = 0.0f;
+    for (Index r = 0; r < rows; ++r) {
+      ref_max = std::max(ref_max, std::fabs(input[r * stride + c]));
+    }
+    INFO("column " << c);
+    CHECK(column_max_absolute[c] == ref_max);
+  }
+}
+
+void TestRowStatistics(RowStatistics backend) {
+  for (Index rows : {1, 3, 4, 9, 37}) {
+    for (Index cols : {1, 17, 64, 100}) {
+      TestRowStatistics(backend, rows, cols, cols);
+      TestRowStatistics(backend, rows, cols, cols + 5);
+    }
+  }
+}
+
+TEST_CASE("RowStatistics SSE2", "[RowStatistics]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestRowStatistics({sse2::RowMaxAbsolute, sse2::RowSum, sse2::RowMeanStd, sse2::ColumnMaxAbsolute});
+}
+
+TEST_CASE("RowStatistics AVX2", "[RowStatistics]") {
+  if (kCPU < CPUType::AVX2) return;
+  TestRowStatistics({avx2::RowMaxAbsolute, avx2::RowSum, avx2::RowMeanStd, avx2::ColumnMaxAbsolute});
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+TEST_CASE("RowStatistics AVX512", "[RowStatistics]") {
+  if (kCPU < CPUType::AVX512BW) return;
+  TestRowStatistics({avx512f::RowMaxAbsolute, avx512f::RowSum, avx512f::RowMeanStd, avx512f::ColumnMaxAbsolute});
+}
+#endif
+
+TEST_CASE("RowStatistics dispatch", "[RowStatistics]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestRowStatistics({RowMaxAbsolute, RowSum, RowMeanStd, ColumnMaxAbsolute});
+}
+
+} // namespace
+} // namespace intgemm
@@ -0,0 +1,75 @@
+// The path is resolved relative to callbacks/implementations.inl, which includes it.
+#define INTGEMM_USER_CALLBACKS "../test/user_callbacks_test.inl"
+
+#include "test.h"
+
+#include <algorithm>
+#include <random>
+
+namespace intgemm {
+
+template <class Routine> void TestUserCallback(Index A_rows, Index width, Index B_cols) {
+  using Integer = typename Routine::Integer;
+  AlignedVector<float> A(A_rows * width);
+  AlignedVector<float> B(width * B_cols);
+  AlignedVector<float> bias(B_cols);
+
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto& it : A) it = dist(gen);
+  for (auto& it : B) it = dist(gen);
+  for (auto& it : bias) it = dist(gen);
+
+  float quant_mult = (sizeof(Integer) == 2) ? 1024 : 64;
+  float unquant_mult = 1.0f / (quant_mult * quant_mult);
+
+  AlignedVector<Integer> A_prep(A.size());
+  AlignedVector<Integer> B_prep(B.size());
+  Routine::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+  Routine::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+
+  AlignedVector<float> expected(A_rows * B_cols);
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), expected.begin()));
+  for (auto& it : expected) it = std::min(std::max(it, 0.0f), 1.0f);
+
+  AlignedVector<float> actual(A_rows * B_cols);
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndClampAndWrite(unquant_mult, bias.begin(), 0.0f, 1.0f, actual.begin()));
+
+  for (Index i = 0; i < actual.size(); ++i)
+    CHECK(actual[i] == expected[i]);
+}
+
+TEST_CASE("User callback SSE2", "[callbacks]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestUserCallback<SSE2_16bit>(8, 256, 256);
+  TestUserCallback<SSE2_16bit>(16, 64, 32);
+}
+
+TEST_CASE("User callback SSSE3", "[callbacks]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestUserCallback<SSSE3_8bit>(8, 256, 256);
+  TestUserCallback<SSSE3_8bit>(16, 64, 32);
+}
+
+TEST_CASE("User callback AVX2", "[callbacks]") {
+  if (kCPU < CPUType::AVX2) return;
+  TestUserCallback<AVX2_8bit>(8, 256, 256);
+  TestUserCallback<AVX2_16bit>(16, 64, 32);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+TEST_CASE("User callback AVX512BW", "[callbacks]") {
+  if (kCPU < CPUType::AVX512BW) return;
+  TestUserCallback<AVX512_8bit>(8, 256, 256);
+  TestUserCallback<AVX512_16bit>(16, 64, 32);
+}
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+TEST_CASE("User callback AVX512VNNI", "[callbacks]") {
+  if (kCPU < CPUType::AVX512VNNI) return;
+  TestUserCallback<AVX512VNNI_8bit>(8, 256, 256);
+}
+#endif
+
+}
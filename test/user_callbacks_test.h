@@ -0,0 +1,22 @@
+#pragma once
+
+#include <algorithm>
+
+// Config of the user-defined callback exercised by user_callbacks_test.cc.  It lives outside intgemm, as
+// it would in a user's project.
+namespace intgemm {
+namespace callbacks {
+
+struct UnquantizeAndAddBiasAndClampAndWrite {
+  float unquant_mult;
+  const float* bias_addr;
+  float lower;
+  float upper;
+  float* output_addr;
+
+  UnquantizeAndAddBiasAndClampAndWrite(float unquant_mult, const float* bias_addr, float lower, float upper, float* output_addr)
+    : unquant_mult(unquant_mult), bias_addr(bias_addr), lower(lower), upper(upper), output_addr(output_addr) {}
+};
+
+}
+}
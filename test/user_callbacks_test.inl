@@ -0,0 +1,30 @@
+/* Included once per architecture through INTGEMM_USER_CALLBACKS, see callbacks/implementations.inl. */
+#include "user_callbacks_test.h"
+
+namespace intgemm {
+namespace callbacks {
+
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndClampAndWrite> {
+public:
+  CPU_ATTR CallbackImpl(const UnquantizeAndAddBiasAndClampAndWrite& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+    lower = set1_ps<vf>(config.lower);
+    upper = set1_ps<vf>(config.upper);
+  }
+
+  CPU_ATTR void operator()(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    result = min_ps(max_ps(result, lower), upper);
+    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+  }
+
+private:
+  UnquantizeAndAddBiasAndClampAndWrite config;
+  vf unquant_mult;
+  vf lower;
+  vf upper;
+};
+
+}
+}
@@ -1,6 +1,10 @@
 #include "test.h"
 #include "../utils.h"
 
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
 namespace intgemm {
 namespace {
 
@@ -91,5 +95,19 @@ TEST_CASE("Round up",) {
   CHECK(round_up(6, 5) == 10);
 }
 
+TEST_CASE("ToFixedPoint",) {
+  for (float scale : {1.f, 0.5f, 0.75f, 1.5f, 3.7e-5f, 0.0123f, 1e-7f}) {
+    FixedPointScale fixed = ToFixedPoint(scale);
+    CHECK(fixed.multiplier >= (1 << 30));
+    CHECK(fixed.right_shift >= 1);
+    CHECK(fixed.right_shift <= 62);
+    CHECK_EPS(std::ldexp(double(fixed.multiplier), -int(fixed.right_shift)), scale, scale * 1e-9);
+  }
+  CHECK(ToFixedPoint(std::ldexp(1.f, -32)).right_shift == 62);
+  CHECK(ToFixedPoint(std::ldexp(1.f, 29)).right_shift == 1);
+  for (float scale : {0.f, -1.f, std::ldexp(1.f, -33), std::ldexp(1.f, 30), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN()})
+    CHECK_THROWS_AS(ToFixedPoint(scale), std::invalid_argument);
+}
+
 }
 }
@@ -46,4 +46,23 @@ enum class CPUType {
 // Running CPU type.  This is defined in intgemm.cc (as the dispatcher).
 extern const CPUType kCPU;
 
+// Register width in bytes that determines the layout of prepared B with
+// integer_bytes-wide integers on cpu, or 0 if cpu cannot multiply them.
+// AVX512BW and AVX512VNNI share a layout, as do SSE2 and SSSE3 for 16-bit.
+static inline Index PreparedBLayout(CPUType cpu, Index integer_bytes) {
+  switch (cpu) {
+    case CPUType::AVX512VNNI:
+    case CPUType::AVX512BW:
+      return 64;
+    case CPUType::AVX2:
+      return 32;
+    case CPUType::SSSE3:
+      return 16;
+    case CPUType::SSE2:
+      return integer_bytes == 2 ? 16 : 0;
+    default:
+      return 0;
+  }
+}
+
 } // namespace intgemm
@@ -1,5 +1,11 @@
 #pragma once
 
+#include "types.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
 #include <tuple>
 
 namespace intgemm {
@@ -205,4 +211,32 @@ static constexpr Index round_up(Index value, Index factor) {
   return (value + factor - 1) / factor * factor;
 }
 
+/*
+ * Fixed-point form of a positive scale for integer-only requantization:
+ *   scale ~= multiplier * 2^-right_shift
+ * with multiplier in [2^30, 2^31) so it keeps 31 significant bits.
+ * Throws std::invalid_argument unless 2^-32 <= scale < 2^30, the scales the
+ * requantize kernel's right shifts of 1 to 62 bits can express.
+ */
+struct FixedPointScale {
+  int32_t multiplier;
+  uint8_t right_shift;
+};
+
+static inline FixedPointScale ToFixedPoint(float scale) {
+  if (!(scale > 0.0f) || !std::isfinite(scale)) throw std::invalid_argument("ToFixedPoint needs a positive, finite scale");
+  int exponent;
+  // scale = mantissa * 2^exponent with mantissa in [0.5, 1).
+  double mantissa = std::frexp(static_cast<double>(scale), &exponent);
+  int64_t multiplier = std::llround(mantissa * (int64_t(1) << 31));
+  if (multiplier == (int64_t(1) << 31)) {
+    multiplier /= 2;
+    ++exponent;
+  }
+  // The requantize kernel shifts 64-bit products right by 1 to 62 bits and
+  // saturates results beyond int32, which scales of 1 or more can produce.
+  if (exponent < -31 || exponent > 30) throw std::invalid_argument("ToFixedPoint scale is outside [2^-32, 2^30)");
+  return {static_cast<int32_t>(multiplier), static_cast<uint8_t>(31 - exponent)};
+}
+
 }